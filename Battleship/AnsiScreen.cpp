@@ -0,0 +1,103 @@
+#include "AnsiScreen.h"
+#include "Board.h"
+#include "globals.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+AnsiScreen::AnsiScreen(int nRows, int nCols)
+ : m_rows(nRows), m_cols(nCols), m_cleared(false)
+{
+    m_out.reserve(2 * (nRows+3) * (nCols+3) + 256);
+}
+
+// screen rows and columns are numbered from 1; each board takes a title
+// line, a column header, its rows and a blank line
+int AnsiScreen::top(int slot) const
+{
+    return 1 + slot * (m_rows + 3);
+}
+
+void AnsiScreen::moveTo(int row, int col)
+{
+    m_out += "\x1b[";
+    m_out += to_string(row);
+    m_out += ';';
+    m_out += to_string(col);
+    m_out += 'H';
+}
+
+void AnsiScreen::writeLine(int row, const string& text)
+{
+    moveTo(row, 1);
+    m_out += "\x1b[2K";
+    m_out += text;
+}
+
+void AnsiScreen::drawBoard(int slot, const Board& b, bool shotsOnly, const string& title)
+{
+    if (!m_cleared)
+    {
+        m_out += "\x1b[2J";
+        m_cleared = true;
+    }
+    writeLine(top(slot), title);
+
+    vector<char>& shown = m_shown[slot];
+    if (shown.empty())
+    {
+          // first time: draw it all
+        string frame;
+        b.render(frame, shotsOnly);
+        size_t start = 0;
+        for (int line = 0; start < frame.size(); line++)
+        {
+            size_t end = frame.find('\n', start);
+            writeLine(top(slot) + 1 + line, frame.substr(start, end - start));
+            start = end + 1;
+        }
+        shown.resize(m_rows * m_cols);
+        for (int r = 0; r < m_rows; r++)
+            for (int c = 0; c < m_cols; c++)
+                shown[r*m_cols + c] = b.symbolAt(Point(r, c), shotsOnly);
+        return;
+    }
+
+      // after that, only the cells that changed; a run of changed cells in
+      // a row needs just one cursor move
+    for (int r = 0; r < m_rows; r++)
+    {
+        int lastWritten = -2;
+        for (int c = 0; c < m_cols; c++)
+        {
+            char ch = b.symbolAt(Point(r, c), shotsOnly);
+            if (ch == shown[r*m_cols + c])
+                continue;
+            if (c != lastWritten + 1)
+                moveTo(top(slot) + 2 + r, 3 + c);
+            m_out += ch;
+            shown[r*m_cols + c] = ch;
+            lastWritten = c;
+        }
+    }
+}
+
+void AnsiScreen::setStatus(const string& text)
+{
+    writeLine(top(2), text.substr(0, text.find('\n')));
+}
+
+void AnsiScreen::present()
+{
+    cout.write(m_out.data(), m_out.size());
+    cout.flush();
+    m_out.clear();
+}
+
+void AnsiScreen::finish()
+{
+    moveTo(top(2) + 1, 1);
+    present();
+}
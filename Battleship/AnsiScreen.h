@@ -0,0 +1,38 @@
+#ifndef ANSISCREEN_INCLUDED
+#define ANSISCREEN_INCLUDED
+
+#include <string>
+#include <vector>
+
+class Board;
+
+// Shows the two boards of a game at fixed places on an ANSI terminal,
+// one above the other, with a status line below them.  After a board is
+// first drawn, drawing it again only rewrites the cells that changed, and
+// everything queued is sent to the terminal in one write by present(),
+// so watching a long game on a big board isn't held up by the terminal.
+class AnsiScreen
+{
+  public:
+    AnsiScreen(int nRows, int nCols);
+      // queue the redraw of board slot (0 or 1) with a title above it
+    void drawBoard(int slot, const Board& b, bool shotsOnly, const std::string& title);
+    void setStatus(const std::string& text);
+      // write out everything queued
+    void present();
+      // put the cursor below the boards, for whatever follows
+    void finish();
+
+  private:
+    void moveTo(int row, int col);
+    void writeLine(int row, const std::string& text);
+    int top(int slot) const;
+
+    int m_rows;
+    int m_cols;
+    std::string m_out;                  // reused for every frame
+    std::vector<char> m_shown[2];       // cells on the screen, per slot
+    bool m_cleared;
+};
+
+#endif // ANSISCREEN_INCLUDED
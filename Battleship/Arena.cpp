@@ -0,0 +1,68 @@
+#include "Arena.h"
+#include <memory_resource>
+#include <new>
+
+using namespace std;
+
+//******************** GameArena functions **************************
+
+GameArena::GameArena(size_t initialBytes)
+ : m_block(new char[initialBytes]), m_size(initialBytes),
+   m_resource(m_block.get(), m_size, &m_overflow)
+{}
+
+GameArena::~GameArena()
+{
+    m_resource.release();
+}
+
+void GameArena::reset()
+{
+    m_resource.release();
+    if (m_overflow.m_bytes == 0)
+        return;
+
+      // the monotonic resource can't change its initial buffer, so make a
+      // new one around a bigger block
+    m_size += m_overflow.m_bytes;
+    m_overflow.m_bytes = 0;
+    m_resource.~monotonic_buffer_resource();
+    m_block.reset(new char[m_size]);
+    new (&m_resource) pmr::monotonic_buffer_resource(m_block.get(), m_size, &m_overflow);
+}
+
+void* GameArena::Overflow::do_allocate(size_t n, size_t align)
+{
+    m_bytes += n;
+    return pmr::new_delete_resource()->allocate(n, align);
+}
+
+void GameArena::Overflow::do_deallocate(void* p, size_t n, size_t align)
+{
+    pmr::new_delete_resource()->deallocate(p, n, align);
+}
+
+bool GameArena::Overflow::do_is_equal(const pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+//******************** GameArenaScope functions *********************
+
+static thread_local pmr::memory_resource* current = nullptr;
+
+pmr::memory_resource* currentGameResource()
+{
+    return current != nullptr ? current : pmr::new_delete_resource();
+}
+
+GameArenaScope::GameArenaScope(GameArena* arena)
+ : m_previous(current)
+{
+    current = (arena != nullptr ? arena->resource() : nullptr);
+}
+
+GameArenaScope::~GameArenaScope()
+{
+    current = m_previous;
+}
@@ -0,0 +1,151 @@
+#ifndef ARENA_INCLUDED
+#define ARENA_INCLUDED
+
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <string>
+#include <new>
+#include <cstddef>
+
+// Per-game memory.  A GameArena hands out memory from one block and takes
+// it all back at once with reset(), so a long run of games doesn't go back
+// to the general-purpose allocator for every game's boards, players and
+// bookkeeping.
+//
+// Nothing is passed around to make this happen.  While a GameArenaScope
+// is alive, the objects its thread creates (a Game's and a Board's
+// implementation, the players, and the containers they hold, which are
+// GameVectors and GameStrings) get their memory from its arena; outside
+// any scope they get it from the heap as usual.  Each object remembers
+// where its memory came from, so it can be destroyed anywhere, but every
+// object made in an arena must be destroyed before the arena is reset.
+//
+// An arena never reuses memory before it is reset, so it suits what a game
+// sets up once, not memory that is repeatedly allocated and freed during
+// play; and it is not thread-safe, so a multithreaded player must make
+// its threads' state outside the scope (GameArenaScope(nullptr)).
+
+class GameArena
+{
+  public:
+    GameArena(size_t initialBytes = 64 * 1024);
+    ~GameArena();
+    std::pmr::memory_resource* resource() { return &m_resource; }
+      // take back everything handed out.  If the block overflowed since the
+      // last reset, it is enlarged to fit, so after the first few games a
+      // run of similar games allocates nothing at all.
+    void reset();
+    size_t capacity() const { return m_size; }
+      // We prevent a GameArena object from being copied or assigned
+    GameArena(const GameArena&) = delete;
+    GameArena& operator=(const GameArena&) = delete;
+
+  private:
+      // the heap, counting what the arena had to take from it
+    class Overflow : public std::pmr::memory_resource
+    {
+      public:
+        Overflow() : m_bytes(0) {}
+        size_t m_bytes;
+      private:
+        virtual void* do_allocate(size_t n, size_t align);
+        virtual void do_deallocate(void* p, size_t n, size_t align);
+        virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept;
+    };
+
+    std::unique_ptr<char[]> m_block;
+    size_t m_size;
+    Overflow m_overflow;
+    std::pmr::monotonic_buffer_resource m_resource;
+};
+
+  // where objects created on this thread get their memory: the arena of
+  // the innermost GameArenaScope, or the heap
+std::pmr::memory_resource* currentGameResource();
+
+class GameArenaScope
+{
+  public:
+    GameArenaScope(GameArena* arena);
+    ~GameArenaScope();
+    GameArenaScope(const GameArenaScope&) = delete;
+    GameArenaScope& operator=(const GameArenaScope&) = delete;
+
+  private:
+    std::pmr::memory_resource* m_previous;
+};
+
+// An allocator that takes its memory from wherever the thread's objects
+// are currently coming from.  As with std::pmr::polymorphic_allocator, a
+// container keeps its allocator for life, and a copy uses the copying
+// thread's current one.
+template <class T>
+class GameAllocator
+{
+  public:
+    typedef T value_type;
+
+    GameAllocator() : m_resource(currentGameResource()) {}
+    GameAllocator(std::pmr::memory_resource* r) : m_resource(r) {}
+    template <class U>
+    GameAllocator(const GameAllocator<U>& other) : m_resource(other.resource()) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(m_resource->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n)
+    {
+        m_resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+    GameAllocator select_on_container_copy_construction() const { return GameAllocator(); }
+    std::pmr::memory_resource* resource() const { return m_resource; }
+
+  private:
+    std::pmr::memory_resource* m_resource;
+};
+
+template <class T, class U>
+bool operator==(const GameAllocator<T>& a, const GameAllocator<U>& b)
+{
+    return a.resource() == b.resource()  ||  a.resource()->is_equal(*b.resource());
+}
+
+template <class T, class U>
+bool operator!=(const GameAllocator<T>& a, const GameAllocator<U>& b)
+{
+    return !(a == b);
+}
+
+template <class T>
+using GameVector = std::vector<T, GameAllocator<T> >;
+
+typedef std::basic_string<char, std::char_traits<char>, GameAllocator<char> > GameString;
+
+// A base for classes whose objects are made with new, so that they too
+// come from the current arena.  The resource is stored just before the
+// object, for operator delete to give the memory back to.
+class ArenaObject
+{
+  public:
+    static void* operator new(size_t n)
+    {
+        std::pmr::memory_resource* r = currentGameResource();
+        char* p = static_cast<char*>(r->allocate(n + HEADER, alignof(std::max_align_t)));
+        *reinterpret_cast<std::pmr::memory_resource**>(p) = r;
+        return p + HEADER;
+    }
+
+    static void operator delete(void* obj, size_t n)
+    {
+        char* p = static_cast<char*>(obj) - HEADER;
+        std::pmr::memory_resource* r = *reinterpret_cast<std::pmr::memory_resource**>(p);
+        r->deallocate(p, n + HEADER, alignof(std::max_align_t));
+    }
+
+  private:
+    static const size_t HEADER = alignof(std::max_align_t);
+};
+
+#endif // ARENA_INCLUDED
@@ -0,0 +1,216 @@
+#include "BatchEngine.h"
+#include "BatchPolicy.h"
+#include "Game.h"
+#include <algorithm>
+
+using namespace std;
+
+BatchEngine::BatchEngine(const Game& g, int nGames)
+ : m_game(g), m_nGames(max(nGames, 1)), m_nCells(g.rows() * g.cols()),
+   m_nWords((m_nGames + 63) / 64), m_nShips(g.nShips()), m_maxTurns(4 * m_nCells),
+   m_turns(0), m_live(m_nWords), m_cells(m_nGames), m_attacked(m_nCells * m_nWords, 0),
+   m_hit(m_nWords), m_sunk(m_nWords), m_wasted(m_nWords), m_sunkShip(m_nGames),
+   m_fleet(m_nShips)
+{
+    for (int side = 0; side < 2; side++)
+    {
+        m_shots[side].resize(m_nCells * m_nWords);
+        m_occupied[side].resize(m_nCells * m_nWords);
+        m_shipAt[side].resize(m_nShips * m_nCells * m_nWords);
+        m_hitsLeft[side].resize(m_nShips * m_nGames);
+        m_shipsLeft[side].resize(m_nGames);
+    }
+      // a turn attacks at most one cell per lane
+    m_attackedRows.reserve(m_nGames);
+}
+
+void BatchEngine::play(BatchPolicy& p1, BatchPolicy& p2, uint64_t seed, BatchResult& result)
+{
+    BatchPolicy* policy[2] = { &p1, &p2 };
+    result.winner.assign(m_nGames, 0);
+    result.turns.assign(m_nGames, 0);
+    result.wins[0] = result.wins[1] = 0;
+
+    resetLanes();
+    m_rng[0].seed(seed);
+    m_rng[1].seed(m_rng[0].next());
+    for (int side = 0; side < 2; side++)
+        policy[side]->begin(*this, side, m_rng[side]);
+
+      // a lane whose fleets can't both be placed is not played
+    for (int side = 0; side < 2; side++)
+    {
+        for (int lane = 0; lane < m_nGames; lane++)
+        {
+            if (isLive(lane)  &&  !(policy[side]->placeFleet(lane, m_fleet)  &&
+                                    place(side, lane, m_fleet)))
+                m_live[lane >> 6] &= ~(uint64_t(1) << (lane & 63));
+        }
+    }
+
+    BatchOutcome outcome;
+    outcome.hit = m_hit.data();
+    outcome.sunk = m_sunk.data();
+    outcome.wasted = m_wasted.data();
+    outcome.ship = m_sunkShip.data();
+    int side = 0;
+    while (any_of(m_live.begin(), m_live.end(), [](uint64_t w) { return w != 0; }))
+    {
+        policy[side]->chooseAttacks(m_cells.data());
+        resolve(side);
+        policy[side]->recordResults(m_cells.data(), outcome);
+        checkWins(side, result);
+        side = 1 - side;
+    }
+}
+
+void BatchEngine::resetLanes()
+{
+    for (int w = 0; w < m_nWords; w++)
+        m_live[w] = ~uint64_t(0);
+    if (m_nGames % 64 != 0)
+        m_live[m_nWords - 1] = (uint64_t(1) << (m_nGames % 64)) - 1;
+    for (int side = 0; side < 2; side++)
+    {
+        fill(m_shots[side].begin(), m_shots[side].end(), 0);
+        fill(m_occupied[side].begin(), m_occupied[side].end(), 0);
+        fill(m_shipAt[side].begin(), m_shipAt[side].end(), 0);
+        fill(m_hitsLeft[side].begin(), m_hitsLeft[side].end(), 0);
+        fill(m_shipsLeft[side].begin(), m_shipsLeft[side].end(), 0);
+    }
+    m_turns = 0;
+}
+
+// Put one lane's fleet on the given side's board, going by each ship's
+// topOrLeft and dir as Board::placeShip does; a ship that is off the board
+// or overlaps another makes the whole layout fail.  The lane then takes no
+// part in the batch, so whatever was set of its fleet is never looked at.
+bool BatchEngine::place(int side, int lane, const GameVector<Placement>& fleet)
+{
+    if (m_nShips > 127  ||  (int)fleet.size() < m_nShips)
+        return false;
+    uint64_t* occupied = m_occupied[side].data();
+    int w = lane >> 6;
+    uint64_t bit = uint64_t(1) << (lane & 63);
+    int cols = m_game.cols();
+    for (int k = 0; k < m_nShips; k++)
+    {
+        Point p = fleet[k].topOrLeft;
+        int len = m_game.shipLength(k);
+        Point end = (fleet[k].dir == HORIZONTAL ? Point(p.r, p.c + len - 1)
+                                                : Point(p.r + len - 1, p.c));
+        if (!m_game.isValid(p)  ||  !m_game.isValid(end))
+            return false;
+        uint64_t* shipAt = &m_shipAt[side][k * m_nCells * m_nWords];
+        int step = (fleet[k].dir == HORIZONTAL ? 1 : cols);
+        for (int i = 0, cell = p.r * cols + p.c; i < len; i++, cell += step)
+        {
+            int row = cell * m_nWords + w;
+            if (occupied[row] & bit)
+                return false;
+            occupied[row] |= bit;
+            shipAt[row] |= bit;
+        }
+        m_hitsLeft[side][k * m_nGames + lane] = len;
+    }
+    m_shipsLeft[side][lane] = m_nShips;
+    return true;
+}
+
+// Carry out this turn's attack in every live lane.  The attacks are first
+// gathered by cell into rows of lane bits, noting each row as it is first
+// used; then each row is resolved against the defender's planes a word at
+// a time, and cleared for the next turn.
+void BatchEngine::resolve(int side)
+{
+    uint64_t* shots = m_shots[side].data();
+    const uint64_t* occupied = m_occupied[1-side].data();
+    const uint64_t* shipAt = m_shipAt[1-side].data();
+    int* hitsLeft = m_hitsLeft[1-side].data();
+    int* shipsLeft = m_shipsLeft[1-side].data();
+    int plane = m_nCells * m_nWords;
+
+    m_attackedRows.clear();
+    for (int w = 0; w < m_nWords; w++)
+    {
+        m_hit[w] = m_sunk[w] = m_wasted[w] = 0;
+        for (uint64_t live = m_live[w]; live != 0; live &= live - 1)
+        {
+            int b = __builtin_ctzll(live);
+            int cell = m_cells[w * 64 + b];
+            if (unsigned(cell) >= unsigned(m_nCells))
+            {
+                m_wasted[w] |= uint64_t(1) << b;
+                continue;
+            }
+            int row = cell * m_nWords + w;
+            if (m_attacked[row] == 0)
+                m_attackedRows.push_back(row);
+            m_attacked[row] |= uint64_t(1) << b;
+        }
+    }
+
+    for (size_t i = 0; i < m_attackedRows.size(); i++)
+    {
+        int row = m_attackedRows[i];
+        int w = row % m_nWords;
+        uint64_t attacked = m_attacked[row];
+        m_attacked[row] = 0;
+        uint64_t fresh = attacked & ~shots[row];
+        shots[row] |= fresh;
+        m_wasted[w] |= attacked & ~fresh;
+        uint64_t hit = fresh & occupied[row];
+        if (hit == 0)
+            continue;
+        m_hit[w] |= hit;
+        for (int k = 0; k < m_nShips  &&  hit != 0; k++)
+        {
+            uint64_t onShip = hit & shipAt[k * plane + row];
+            hit &= ~onShip;
+            for (; onShip != 0; onShip &= onShip - 1)
+            {
+                int b = __builtin_ctzll(onShip);
+                int lane = w * 64 + b;
+                if (--hitsLeft[k * m_nGames + lane] == 0)
+                {
+                    m_sunk[w] |= uint64_t(1) << b;
+                    m_sunkShip[lane] = int8_t(k);
+                    shipsLeft[lane]--;
+                }
+            }
+        }
+    }
+    m_turns++;
+}
+
+// End the lanes in which the side that just attacked has sunk the whole
+// fleet, which can only be lanes that sank a ship this turn, and every
+// lane once the games have gone on too long
+void BatchEngine::checkWins(int side, BatchResult& result)
+{
+    const int* shipsLeft = m_shipsLeft[1-side].data();
+    bool endless = (m_turns >= m_maxTurns);
+    for (int w = 0; w < m_nWords; w++)
+    {
+        if (m_live[w] == 0)
+            continue;
+        uint64_t won = 0;
+        for (uint64_t sunk = m_sunk[w] & m_live[w]; sunk != 0; sunk &= sunk - 1)
+        {
+            int b = __builtin_ctzll(sunk);
+            won |= uint64_t(shipsLeft[w * 64 + b] == 0) << b;
+        }
+        uint64_t over = (endless ? m_live[w] : won);
+        for (uint64_t bits = over; bits != 0; bits &= bits - 1)
+        {
+            int lane = w * 64 + __builtin_ctzll(bits);
+            result.turns[lane] = m_turns;
+            if ((won >> (lane & 63)) & 1)
+            {
+                result.winner[lane] = side + 1;
+                result.wins[side]++;
+            }
+        }
+        m_live[w] &= ~over;
+    }
+}
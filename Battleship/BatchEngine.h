@@ -0,0 +1,123 @@
+#ifndef BATCHENGINE_INCLUDED
+#define BATCHENGINE_INCLUDED
+
+#include "globals.h"
+#include "Arena.h"
+#include "PlacementSolver.h"
+#include <vector>
+#include <cstdint>
+
+class Game;
+class BatchPolicy;
+
+// Outcome of a batch, one entry per game
+struct BatchResult
+{
+    std::vector<int> winner;    // 1 if p1 won, 2 if p2 won, 0 if the game was
+                                //   not played or was given up as endless
+    std::vector<int> turns;     // attacks made by both players together
+    int wins[2];                // games won by p1 and by p2
+};
+
+// What one turn's attacks came to, as words of lane bits laid out like
+// BatchEngine::liveLanes().  A live lane in none of hit and wasted missed.
+struct BatchOutcome
+{
+    const uint64_t* hit;        // the attack hit a ship, perhaps sinking it
+    const uint64_t* sunk;       // the attack sank a ship
+    const uint64_t* wasted;     // the cell was off the board or attacked before
+    const int8_t* ship;         // per lane: the shipId sunk, for lanes in sunk
+};
+
+// Plays many independent games of one Game's size and fleet at once.
+// Instead of a Board and a pair of Players per game, every game is a lane
+// of a few shared arrays, and everything the engine knows about a cell is
+// kept as a bit plane: for every cell, a row of words holding one bit per
+// lane.  There are planes for the cells each side has attacked, for the
+// cells its ships cover, and for each of its ships on its own.  Only the
+// hits left on each ship and the ships left afloat are counters, one per
+// lane.
+//
+// Each turn, one side's BatchPolicy picks a cell for every lane still
+// playing.  The engine gathers those choices into a word of lanes per
+// cell attacked, and resolves each word with a handful of operations on
+// the planes' rows for that cell: the lanes that hit are the attacked
+// lanes not attacked there before that have a ship there.  Only the lanes
+// that hit are then looked at one by one, to count down their ship.  The
+// more lanes attack the same cell, the fewer words there are to resolve;
+// when every lane attacks the same cell, a turn takes one word operation
+// per 64 games.  The outcome goes back to the policy as words of lanes,
+// so a policy need only look at the lanes whose attack hit.
+//
+// A lane that is over stays in the arrays but takes no part, and the batch
+// ends when no lane is live.  This complements Game::play rather than
+// replacing it, and gives only the outcome of each game.  Ship ids must
+// fit in a signed byte, so a fleet has at most 127 ships.
+class BatchEngine
+{
+  public:
+    BatchEngine(const Game& g, int nGames);
+
+    const Game& game() const { return m_game; }
+    int nGames() const { return m_nGames; }
+    int nCells() const { return m_nCells; }
+      // words in a row of a bit plane (a bit for each lane)
+    int nWords() const { return m_nWords; }
+
+      // play a batch of nGames games of p1 against p2, p1 attacking first
+      // in every one; the policies' random choices come from seed, so the
+      // same seed and policies give the same batch
+    void play(BatchPolicy& p1, BatchPolicy& p2, uint64_t seed, BatchResult& result);
+
+      // the words of the live lanes, bit (lane % 64) of word lane / 64
+    const uint64_t* liveLanes() const { return m_live.data(); }
+    bool isLive(int lane) const { return (m_live[lane >> 6] >> (lane & 63)) & 1; }
+
+      // whether the given side has attacked this cell in this lane
+    bool isShot(int side, int lane, int cell) const
+    {
+        return (m_shots[side][cell * m_nWords + (lane >> 6)] >> (lane & 63)) & 1;
+    }
+      // the row of the given side's shot plane for a cell
+    const uint64_t* shotPlane(int side, int cell) const
+    {
+        return &m_shots[side][cell * m_nWords];
+    }
+
+      // We prevent a BatchEngine object from being copied or assigned
+    BatchEngine(const BatchEngine&) = delete;
+    BatchEngine& operator=(const BatchEngine&) = delete;
+
+  private:
+    bool place(int side, int lane, const GameVector<Placement>& fleet);
+    void resetLanes();
+    void resolve(int side);
+    void checkWins(int side, BatchResult& result);
+
+    const Game& m_game;
+    int m_nGames;
+    int m_nCells;
+    int m_nWords;
+    int m_nShips;
+    int m_maxTurns;                     // a game this long is given up
+    int m_turns;                        // attacks so far in every live lane
+    GameVector<uint64_t> m_live;        // one bit per lane
+    GameVector<uint64_t> m_shots[2];    // per attacker: nCells rows of nWords
+    GameVector<uint64_t> m_occupied[2]; // per defender: nCells rows of nWords
+    GameVector<uint64_t> m_shipAt[2];   // per defender: nCells rows of nWords
+                                        //   for each ship in turn
+    GameVector<int> m_hitsLeft[2];      // per defender: nGames per ship
+    GameVector<int> m_shipsLeft[2];     // per defender: one per lane
+    GameVector<int> m_cells;            // this turn's attack in each lane
+    GameVector<uint64_t> m_attacked;    // nCells rows of nWords: this turn's
+                                        //   attacks, while they are resolved
+    GameVector<int> m_attackedRows;     // the rows of m_attacked in use
+    GameVector<uint64_t> m_hit;         // this turn's outcome, as in
+    GameVector<uint64_t> m_sunk;        //   BatchOutcome
+    GameVector<uint64_t> m_wasted;
+    GameVector<int8_t> m_sunkShip;
+    GameVector<Placement> m_fleet;
+    Rng m_rng[2];                       // the policies' random choices
+};
+
+#endif // BATCHENGINE_INCLUDED
@@ -0,0 +1,562 @@
+#include "BatchPolicy.h"
+#include "BatchEngine.h"
+#include "Game.h"
+#include "globals.h"
+#include "Bitboard.h"
+#include "FleetSampler.h"
+#include "HuntPolicy.h"
+#include "HitTracker.h"
+#include "PlacementSolver.h"
+#include <string>
+#include <algorithm>
+
+using namespace std;
+
+// Random fleets, drawn the way MediocrePlayer and GoodPlayer place theirs:
+// uniformly by the fleet sampler, falling back to the placement solver on
+// boards too crowded for sampling
+class RandomFleets
+{
+  public:
+    RandomFleets(const Game& g) : m_sampler(g), m_solver(g) {}
+
+    bool draw(Rng& rng, GameVector<Placement>& fleet)
+    {
+        if (m_sampler.sample(rng, Bitboard(), fleet))
+            return true;
+        return m_solver.solve(m_solver.randomBlock(rng), fleet)  ||
+               m_solver.solve(Bitboard(), fleet);
+    }
+
+  private:
+    FleetSampler m_sampler;
+    PlacementSolver m_solver;
+};
+
+// A HuntPolicy for every lane of a batch, kept small so that a batch's
+// lanes stay in cache.  The lattices are worked out once and shared by all
+// the lanes, as rows of words like a lane's own.  A lane has only its
+// attacked cells, as a row of words, the ships it has left afloat of each
+// length, its stride and lattice, and counts of the cells it has attacked
+// and of those left on its lattice, which are kept up as it attacks.
+//
+// Rather than keeping the lattice's unattacked cells in an array, as a
+// HuntPolicy does, a lane draws from the lattice's whole list of cells
+// until it comes to one it hasn't attacked; while a quarter or more of
+// the lattice is left, that takes four draws at most on average.  Past
+// that, it picks the cell by a count and a select on the lattice's words
+// with its attacked cells taken away.  Once the lattice is used up, the
+// choice is made the same way on the lattice of stride 1, the whole board.
+class LaneHunt
+{
+  public:
+    LaneHunt(const Game& g);
+
+      // every ship afloat and nothing attacked, in each of nGames lanes
+    void reset(int nGames);
+    bool isShot(int lane, int cell) const
+    {
+        return (m_shot[lane * m_nWords + (cell >> 6)] >> (cell & 63)) & 1;
+    }
+      // cell (which must be on the board) has been attacked in this lane;
+      // marking a cell twice is harmless
+    void markShot(int lane, int cell);
+    void recordSink(int lane, int shipId);
+      // set cell to one this lane hasn't attacked, chosen as a HuntPolicy
+      // would; return false if it has attacked every cell
+    bool choose(int lane, Rng& rng, int& cell);
+
+  private:
+    const uint64_t* mask(int l) const { return &m_masks[l * m_nWords]; }
+    bool onLattice(int l, int cell) const { return (mask(l)[cell >> 6] >> (cell & 63)) & 1; }
+    int countLeft(int lane, int l) const;
+    void setStride(int lane);
+    void chooseLattice(int lane, Rng& rng);
+
+    const Game& m_game;
+    HuntLattices m_lattices;
+    int m_nCells;
+    int m_nWords;                   // words in a row of cells
+    int m_nLengths;                 // 1 more than the longest ship
+    GameVector<uint64_t> m_masks;   // m_nWords per lattice: its cells
+    GameVector<uint64_t> m_shot;    // m_nWords per lane
+    GameVector<int> m_nShot;        // per lane: cells attacked
+    GameVector<int> m_afloat;       // m_nLengths per lane: ships afloat of each length
+    GameVector<int> m_stride;       // per lane
+    GameVector<int> m_lattice;      // per lane: the lattice's number, or -1
+                                    //   until it is chosen
+    GameVector<int> m_left;         // per lane: its lattice's cells not attacked
+};
+
+LaneHunt::LaneHunt(const Game& g)
+ : m_game(g), m_lattices(g), m_nCells(g.rows() * g.cols()), m_nWords((m_nCells + 63) / 64),
+   m_nLengths(m_lattices.maxStride() + 1)
+{
+    int nLattices = HuntLattices::lattice(m_lattices.maxStride() + 1, 0);
+    m_masks.assign(nLattices * m_nWords, 0);
+    for (int l = 0; l < nLattices; l++)
+    {
+        for (const int* c = m_lattices.begin(l); c != m_lattices.end(l); c++)
+            m_masks[l * m_nWords + (*c >> 6)] |= uint64_t(1) << (*c & 63);
+    }
+}
+
+void LaneHunt::reset(int nGames)
+{
+    m_shot.assign(nGames * m_nWords, 0);
+    m_nShot.assign(nGames, 0);
+    m_afloat.assign(nGames * m_nLengths, 0);
+    m_stride.assign(nGames, 0);
+    m_lattice.assign(nGames, -1);
+    m_left.assign(nGames, 0);
+    for (int lane = 0; lane < nGames; lane++)
+    {
+        for (int k = 0; k < m_game.nShips(); k++)
+            m_afloat[lane * m_nLengths + m_game.shipLength(k)]++;
+        setStride(lane);
+    }
+}
+
+void LaneHunt::markShot(int lane, int cell)
+{
+    uint64_t& word = m_shot[lane * m_nWords + (cell >> 6)];
+    uint64_t bit = uint64_t(1) << (cell & 63);
+    if (word & bit)
+        return;
+    word |= bit;
+    m_nShot[lane]++;
+    int l = m_lattice[lane];
+    if (l >= 0  &&  onLattice(l, cell))
+        m_left[lane]--;
+}
+
+void LaneHunt::recordSink(int lane, int shipId)
+{
+    int len = m_game.shipLength(shipId);
+    int& afloat = m_afloat[lane * m_nLengths + len];
+    if (afloat > 0)
+        afloat--;
+    if (len == m_stride[lane])
+        setStride(lane);
+}
+
+void LaneHunt::setStride(int lane)
+{
+    const int* afloat = &m_afloat[lane * m_nLengths];
+    int stride = 1;
+    for (int len = 1; len < m_nLengths; len++)
+    {
+        if (afloat[len] > 0)
+        {
+            stride = len;
+            break;
+        }
+    }
+    if (stride != m_stride[lane])
+    {
+        m_stride[lane] = stride;
+        m_lattice[lane] = -1;
+    }
+}
+
+// the cells of lattice l this lane hasn't attacked
+int LaneHunt::countLeft(int lane, int l) const
+{
+    const uint64_t* on = mask(l);
+    const uint64_t* shot = &m_shot[lane * m_nWords];
+    int n = 0;
+    for (int w = 0; w < m_nWords; w++)
+        n += popcount64(on[w] & ~shot[w]);
+    return n;
+}
+
+// move to the lattice of the lane's stride with the fewest cells left,
+// taking one at random if several tie
+void LaneHunt::chooseLattice(int lane, Rng& rng)
+{
+    int fewest = m_nCells + 1;
+    int nTied = 0;
+    for (int o = 0; o < m_stride[lane]; o++)
+    {
+        int l = HuntLattices::lattice(m_stride[lane], o);
+        int n = countLeft(lane, l);
+        if (n < fewest)
+        {
+            fewest = n;
+            nTied = 0;
+        }
+        if (n == fewest  &&  rng.randInt(++nTied) == 0)
+            m_lattice[lane] = l;
+    }
+    m_left[lane] = fewest;
+}
+
+bool LaneHunt::choose(int lane, Rng& rng, int& cell)
+{
+    if (m_lattice[lane] < 0)
+        chooseLattice(lane, rng);
+    int l = m_lattice[lane];
+    int n = m_left[lane];
+    if (n == 0)
+    {
+        l = HuntLattices::lattice(1, 0);
+        n = m_nCells - m_nShot[lane];
+        if (n == 0)
+            return false;
+    }
+
+    const int* cells = m_lattices.begin(l);
+    int size = int(m_lattices.end(l) - cells);
+    if (4 * n >= size)
+    {
+        do
+            cell = cells[rng.randInt(size)];
+        while (isShot(lane, cell));
+        return true;
+    }
+
+    const uint64_t* on = mask(l);
+    const uint64_t* shot = &m_shot[lane * m_nWords];
+    int k = rng.randInt(n);
+    for (int w = 0; ; w++)
+    {
+        uint64_t open = on[w] & ~shot[w];
+        int count = popcount64(open);
+        if (k < count)
+        {
+            cell = w * 64 + selectInWord(open, k);
+            return true;
+        }
+        k -= count;
+    }
+}
+
+// What the policies that track each lane's game share: the engine and side
+// they play for, their random numbers, the board's width (asked of the
+// Game once, not once per lane and turn), and the lanes' hunts
+class LanePolicy : public BatchPolicy
+{
+  public:
+    LanePolicy(const Game& g)
+     : BatchPolicy(g), m_engine(nullptr), m_side(0), m_rng(nullptr), m_cols(g.cols()),
+       m_hunt(g)
+    {}
+    virtual void begin(const BatchEngine& e, int side, Rng& rng)
+    {
+        m_engine = &e;
+        m_side = side;
+        m_rng = &rng;
+        m_hunt.reset(e.nGames());
+    }
+
+  protected:
+    const BatchEngine* m_engine;
+    int m_side;
+    Rng* m_rng;
+    int m_cols;
+    LaneHunt m_hunt;
+};
+
+//*********************************************************************
+//  AwfulPolicy
+//*********************************************************************
+
+// Every lane plays like an AwfulPlayer: the ships are clustered in the top
+// left corner, and the attacks sweep the board backwards from the last
+// cell.  Every lane attacks the same cell each turn, so the engine
+// resolves a whole word of lanes at once.
+class AwfulPolicy : public BatchPolicy
+{
+  public:
+    AwfulPolicy(const Game& g) : BatchPolicy(g), m_engine(nullptr), m_last(0) {}
+    virtual string type() const { return "awful"; }
+    virtual void begin(const BatchEngine& e, int side, Rng& rng);
+    virtual bool placeFleet(int lane, GameVector<Placement>& fleet);
+    virtual void chooseAttacks(int* cells);
+    virtual void recordResults(const int* /* cells */, const BatchOutcome& /* outcome */) {}
+
+  private:
+    const BatchEngine* m_engine;
+    int m_last;                 // the cell every lane attacked last
+};
+
+void AwfulPolicy::begin(const BatchEngine& e, int /* side */, Rng& /* rng */)
+{
+    m_engine = &e;
+    m_last = 0;
+}
+
+bool AwfulPolicy::placeFleet(int /* lane */, GameVector<Placement>& fleet)
+{
+      // Clustering ships is bad strategy
+    for (int k = 0; k < game().nShips(); k++)
+    {
+        Placement& p = fleet[k];
+        p.topOrLeft = Point(k, 0);
+        p.dir = HORIZONTAL;
+        p.first = k * game().cols();
+        p.step = 1;
+        p.length = game().shipLength(k);
+    }
+    return true;
+}
+
+void AwfulPolicy::chooseAttacks(int* cells)
+{
+    m_last = (m_last == 0 ? m_engine->nCells() : m_last) - 1;
+    for (int w = 0; w < m_engine->nWords(); w++)
+    {
+        for (uint64_t live = m_engine->liveLanes()[w]; live != 0; live &= live - 1)
+            cells[w * 64 + __builtin_ctzll(live)] = m_last;
+    }
+}
+
+//*********************************************************************
+//  MediocrePolicy
+//*********************************************************************
+
+// Every lane plays like a MediocrePlayer: random attacks on its hunt's
+// lattice until a hit, then random attacks within 4 cells of that hit, in
+// line with it, until a ship is sunk.  The cells within 4 of each cell are
+// listed once for all the lanes.
+class MediocrePolicy : public LanePolicy
+{
+  public:
+    MediocrePolicy(const Game& g);
+    virtual string type() const { return "mediocre"; }
+    virtual void begin(const BatchEngine& e, int side, Rng& rng);
+    virtual bool placeFleet(int lane, GameVector<Placement>& fleet);
+    virtual void chooseAttacks(int* cells);
+    virtual void recordResults(const int* cells, const BatchOutcome& outcome);
+
+  private:
+    static const int CROSS = 16;    // the most cells within 4 of one
+
+    int choose(int lane);
+
+    RandomFleets m_fleets;
+    GameVector<int> m_cross;        // CROSS per cell: the cells within 4 of it
+    GameVector<int> m_nCross;       // per cell: how many there are
+    GameVector<int8_t> m_state;     // per lane: 1 searching, 2 attacking near m_lastHit
+    GameVector<int> m_lastHit;      // per lane
+};
+
+MediocrePolicy::MediocrePolicy(const Game& g)
+ : LanePolicy(g), m_fleets(g), m_cross(CROSS * g.rows() * g.cols()),
+   m_nCross(g.rows() * g.cols(), 0)
+{
+    for (int cell = 0; cell < g.rows() * g.cols(); cell++)
+    {
+        Point hit(cell / g.cols(), cell % g.cols());
+        for (int d = 1; d <= 4; d++)
+        {
+            Point around[4] = {
+                Point(hit.r+d, hit.c), Point(hit.r-d, hit.c),
+                Point(hit.r, hit.c+d), Point(hit.r, hit.c-d)
+            };
+            for (int k = 0; k < 4; k++)
+            {
+                if (g.isValid(around[k]))
+                    m_cross[CROSS * cell + m_nCross[cell]++] = around[k].r * g.cols() + around[k].c;
+            }
+        }
+    }
+}
+
+void MediocrePolicy::begin(const BatchEngine& e, int side, Rng& rng)
+{
+    LanePolicy::begin(e, side, rng);
+    m_state.assign(e.nGames(), 1);
+    m_lastHit.assign(e.nGames(), 0);
+}
+
+bool MediocrePolicy::placeFleet(int /* lane */, GameVector<Placement>& fleet)
+{
+    return m_fleets.draw(*m_rng, fleet);
+}
+
+void MediocrePolicy::chooseAttacks(int* cells)
+{
+    for (int w = 0; w < m_engine->nWords(); w++)
+    {
+        for (uint64_t live = m_engine->liveLanes()[w]; live != 0; live &= live - 1)
+        {
+            int lane = w * 64 + __builtin_ctzll(live);
+            cells[lane] = choose(lane);
+        }
+    }
+}
+
+int MediocrePolicy::choose(int lane)
+{
+    if (m_state[lane] == 2)
+    {
+          // a random unattacked cell within the +-4 "cross" of the last hit
+        const int* cross = &m_cross[CROSS * m_lastHit[lane]];
+        int open[CROSS];
+        int nCandidates = 0;
+        for (int i = 0; i < m_nCross[m_lastHit[lane]]; i++)
+        {
+            open[nCandidates] = cross[i];
+            nCandidates += !m_hunt.isShot(lane, cross[i]);
+        }
+        if (nCandidates > 0)
+            return open[m_rng->randInt(nCandidates)];
+          // every cell of the cross has been attacked without sinking a
+          // ship, so some ship must be longer than 5
+        m_state[lane] = 1;
+    }
+
+    int cell;
+    return m_hunt.choose(lane, *m_rng, cell) ? cell : 0;
+}
+
+// a miss changes nothing but the lane's hunt, so only the lanes that hit
+// are looked at one by one
+void MediocrePolicy::recordResults(const int* cells, const BatchOutcome& outcome)
+{
+    for (int w = 0; w < m_engine->nWords(); w++)
+    {
+        uint64_t live = m_engine->liveLanes()[w];
+        for (uint64_t shot = live & ~outcome.wasted[w]; shot != 0; shot &= shot - 1)
+        {
+            int lane = w * 64 + __builtin_ctzll(shot);
+            m_hunt.markShot(lane, cells[lane]);
+        }
+        for (uint64_t hit = live & outcome.hit[w]; hit != 0; hit &= hit - 1)
+        {
+            int b = __builtin_ctzll(hit);
+            int lane = w * 64 + b;
+            if ((outcome.sunk[w] >> b) & 1)
+            {
+                m_state[lane] = 1;
+                m_hunt.recordSink(lane, outcome.ship[lane]);
+            }
+            else
+            {
+                if (m_state[lane] == 1)
+                    m_lastHit[lane] = cells[lane];
+                m_state[lane] = 2;
+            }
+        }
+    }
+}
+
+//*********************************************************************
+//  GoodPolicy
+//*********************************************************************
+
+// Every lane plays like a GoodPlayer: while a HitTracker of its own has
+// hits a ship afloat could cover, it fires next to one of them, and
+// otherwise it hunts.  The targeting is a GoodPlayer's own, lane by lane,
+// so it costs as much here as in a game of GoodPlayers.
+class GoodPolicy : public LanePolicy
+{
+  public:
+    GoodPolicy(const Game& g) : LanePolicy(g), m_fleets(g) {}
+    virtual string type() const { return "good"; }
+    virtual void begin(const BatchEngine& e, int side, Rng& rng);
+    virtual bool placeFleet(int lane, GameVector<Placement>& fleet);
+    virtual void chooseAttacks(int* cells);
+    virtual void recordResults(const int* cells, const BatchOutcome& outcome);
+
+  private:
+    RandomFleets m_fleets;
+    GameVector<HitTracker> m_hits;  // per lane
+};
+
+void GoodPolicy::begin(const BatchEngine& e, int side, Rng& rng)
+{
+    LanePolicy::begin(e, side, rng);
+    if ((int)m_hits.size() != e.nGames())
+    {
+        m_hits.clear();
+        m_hits.reserve(e.nGames());
+        for (int lane = 0; lane < e.nGames(); lane++)
+            m_hits.emplace_back(game());
+    }
+    else
+    {
+        for (int lane = 0; lane < e.nGames(); lane++)
+            m_hits[lane].reset();
+    }
+}
+
+bool GoodPolicy::placeFleet(int /* lane */, GameVector<Placement>& fleet)
+{
+    return m_fleets.draw(*m_rng, fleet);
+}
+
+void GoodPolicy::chooseAttacks(int* cells)
+{
+    for (int w = 0; w < m_engine->nWords(); w++)
+    {
+        for (uint64_t live = m_engine->liveLanes()[w]; live != 0; live &= live - 1)
+        {
+            int lane = w * 64 + __builtin_ctzll(live);
+            HitTracker& hits = m_hits[lane];
+            Point p;
+            int cell;
+            if (hits.hasOpenHits()  &&  hits.target(p))
+                cells[lane] = p.r * m_cols + p.c;
+            else
+                cells[lane] = (m_hunt.choose(lane, *m_rng, cell) ? cell : 0);
+        }
+    }
+}
+
+void GoodPolicy::recordResults(const int* cells, const BatchOutcome& outcome)
+{
+    for (int w = 0; w < m_engine->nWords(); w++)
+    {
+        uint64_t live = m_engine->liveLanes()[w];
+        for (uint64_t shot = live & ~outcome.wasted[w]; shot != 0; shot &= shot - 1)
+        {
+            int b = __builtin_ctzll(shot);
+            int lane = w * 64 + b;
+            Point p(cells[lane] / m_cols, cells[lane] % m_cols);
+            m_hunt.markShot(lane, cells[lane]);
+            if (((outcome.hit[w] >> b) & 1) == 0)
+                m_hits[lane].recordMiss(p);
+            else if (((outcome.sunk[w] >> b) & 1) == 0)
+                m_hits[lane].recordHit(p);
+            else
+            {
+                m_hits[lane].recordSink(p, outcome.ship[lane]);
+                m_hunt.recordSink(lane, outcome.ship[lane]);
+            }
+        }
+    }
+}
+
+//*********************************************************************
+//  createBatchPolicy
+//*********************************************************************
+
+static const string batchPolicyTypes[] = {
+    "awful", "mediocre", "good"
+};
+
+int nBatchPolicyTypes()
+{
+    return sizeof(batchPolicyTypes)/sizeof(batchPolicyTypes[0]);
+}
+
+string batchPolicyType(int i)
+{
+    return batchPolicyTypes[i];
+}
+
+BatchPolicy* createBatchPolicy(string type, const Game& g)
+{
+    int pos;
+    for (pos = 0; pos != nBatchPolicyTypes()  &&  type != batchPolicyTypes[pos]; pos++)
+        ;
+    switch (pos)
+    {
+      case 0:  return new AwfulPolicy(g);
+      case 1:  return new MediocrePolicy(g);
+      case 2:  return new GoodPolicy(g);
+      default: return nullptr;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef BATCHPOLICY_INCLUDED
+#define BATCHPOLICY_INCLUDED
+
+#include "globals.h"
+#include "Arena.h"
+#include "PlacementSolver.h"
+#include <string>
+#include <cstdint>
+
+class Game;
+class BatchEngine;
+struct BatchOutcome;
+
+// A computer player's strategy for every game of a BatchEngine batch at
+// once.  Where a Player makes one decision per call, a policy makes one
+// per live lane: it keeps its per-game state in arrays indexed by lane, and
+// is called once per turn for the whole batch.  Cells are numbered in
+// row-major order (r*cols+c); an attack on a cell that is off the board
+// or already attacked is wasted.
+class BatchPolicy : public ArenaObject
+{
+  public:
+    BatchPolicy(const Game& g) : m_game(g) {}
+    virtual ~BatchPolicy() {}
+    virtual std::string type() const = 0;
+      // get ready for a new batch of e's games, attacking as the given
+      // side (0 for p1, 1 for p2) and drawing random choices from rng
+    virtual void begin(const BatchEngine& e, int side, Rng& rng) = 0;
+      // lay out the fleet of one lane, indexed by shipId; return false if
+      // the ships can't be placed
+    virtual bool placeFleet(int lane, GameVector<Placement>& fleet) = 0;
+      // choose a cell to attack in every live lane of the engine
+    virtual void chooseAttacks(int* cells) = 0;
+      // what the attack each live lane made at cells[lane] came to
+    virtual void recordResults(const int* cells, const BatchOutcome& outcome) = 0;
+    const Game& game() const { return m_game; }
+      // We prevent any kind of BatchPolicy object from being copied or assigned
+    BatchPolicy(const BatchPolicy&) = delete;
+    BatchPolicy& operator=(const BatchPolicy&) = delete;
+
+  private:
+    const Game& m_game;
+};
+
+  // a policy that plays like the Player type of the same name ("awful",
+  // "mediocre" or "good"), or nullptr if there is none
+BatchPolicy* createBatchPolicy(std::string type, const Game& g);
+
+  // The type names createBatchPolicy accepts, numbered 0 to nBatchPolicyTypes()-1
+int nBatchPolicyTypes();
+std::string batchPolicyType(int i);
+
+#endif // BATCHPOLICY_INCLUDED
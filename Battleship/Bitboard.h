@@ -0,0 +1,455 @@
+#ifndef BITBOARD_INCLUDED
+#define BITBOARD_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+// The number of bits set in a word.  Unless the compiler may use the CPU's
+// popcount instruction, the builtin is a library call, so the bits are
+// added up in place instead, a pair, a nibble and a byte at a time.
+inline int popcount64(uint64_t v)
+{
+#ifdef __POPCNT__
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return int((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// For each byte value and k from 0 to 7, the position of the byte's k-th
+// lowest set bit (8 if it has no such bit)
+struct SelectInByteTable
+{
+    constexpr SelectInByteTable() : pos()
+    {
+        for (int v = 0; v < 256; v++)
+        {
+            for (int k = 0; k < 8; k++)
+                pos[v][k] = 8;
+            for (int bit = 0, k = 0; bit < 8; bit++)
+                if ((v >> bit) & 1)
+                    pos[v][k++] = uint8_t(bit);
+        }
+    }
+    uint8_t pos[256][8];
+};
+inline constexpr SelectInByteTable selectInByte;
+
+// The position of the k-th lowest set bit of v (k from 0 to popcount64(v)-1),
+// without a branch.  Multiplying the bit counts of v's bytes by 0x0101...
+// gives, in each byte, the number of set bits up to and including that
+// byte; comparing all eight with k at once (subtracting with each byte's
+// top bit set, so no byte borrows from the next) counts the bytes below
+// the one holding the bit, and the table finds the bit within it.
+inline int selectInWord(uint64_t v, int k)
+{
+    const uint64_t ONES = 0x0101010101010101ULL;
+    const uint64_t TOPS = 0x8080808080808080ULL;
+    uint64_t b = v - ((v >> 1) & 0x5555555555555555ULL);
+    b = (b & 0x3333333333333333ULL) + ((b >> 2) & 0x3333333333333333ULL);
+    b = (b + (b >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    uint64_t upTo = b * ONES;
+    uint64_t atMost = ((uint64_t(k) * ONES | TOPS) - upTo) & TOPS;
+    int place = int(((atMost >> 7) * ONES) >> 56) * 8;
+    int rank = k - int(((upTo << 8) >> place) & 0xff);
+    return place + selectInByte.pos[(v >> place) & 0xff][rank];
+}
+
+// A set of board cells, one bit per cell, packed 64 to a word.  Cells are
+// numbered in row-major order, so cell (r, c) of a board with nCols columns
+// is bit r*nCols+c.
+//
+// A set holds as many words as its highest cell needs and grows when a
+// higher cell is added; missing words count as empty, so sets of different
+// sizes can be combined freely.  Up to INLINE_CELLS cells are stored inside
+// the object itself, so boards up to that size never touch the heap; larger
+// boards keep their words in one contiguous heap block.
+template <int INLINE_CELLS>
+class BasicBitboard
+{
+  public:
+    static const int INLINE_WORDS = (INLINE_CELLS + 63) / 64;
+
+    BasicBitboard() : m_nWords(0)
+    {
+        for (int i = 0; i < INLINE_WORDS; i++)
+            m_inline[i] = 0;
+    }
+
+      // an empty set with room for nBits cells
+    explicit BasicBitboard(int nBits) : BasicBitboard() { resize((nBits + 63) / 64); }
+
+    void clear()
+    {
+        uint64_t* w = words();
+        for (int i = 0; i < m_nWords; i++)
+            w[i] = 0;
+    }
+
+    bool test(int i) const
+    {
+        return (i >> 6) < m_nWords  &&  ((words()[i >> 6] >> (i & 63)) & 1);
+    }
+
+    void set(int i)
+    {
+        if ((i >> 6) >= m_nWords)
+            resize((i >> 6) + 1);
+        words()[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+
+    void reset(int i)
+    {
+        if ((i >> 6) < m_nWords)
+            words()[i >> 6] &= ~(uint64_t(1) << (i & 63));
+    }
+
+    int count() const
+    {
+        const uint64_t* w = words();
+        int n = 0;
+        for (int i = 0; i < m_nWords; i++)
+            n += popcount64(w[i]);
+        return n;
+    }
+
+    bool any() const
+    {
+        const uint64_t* w = words();
+        for (int i = 0; i < m_nWords; i++)
+            if (w[i] != 0)
+                return true;
+        return false;
+    }
+
+    bool none() const { return !any(); }
+
+    bool intersects(const BasicBitboard& other) const
+    {
+        const uint64_t* a = words();
+        const uint64_t* b = other.words();
+        int n = (m_nWords < other.m_nWords ? m_nWords : other.m_nWords);
+        for (int i = 0; i < n; i++)
+            if (a[i] & b[i])
+                return true;
+        return false;
+    }
+
+    BasicBitboard& operator|=(const BasicBitboard& other)
+    {
+        if (other.m_nWords > m_nWords)
+            resize(other.m_nWords);
+        uint64_t* a = words();
+        const uint64_t* b = other.words();
+        for (int i = 0; i < other.m_nWords; i++)
+            a[i] |= b[i];
+        return *this;
+    }
+
+    BasicBitboard& operator&=(const BasicBitboard& other)
+    {
+        uint64_t* a = words();
+        const uint64_t* b = other.words();
+        for (int i = 0; i < m_nWords; i++)
+            a[i] = (i < other.m_nWords ? a[i] & b[i] : 0);
+        return *this;
+    }
+
+      // the same for a set given as its first n words, such as a
+      // PlacementMasks mask; these make no copy of it
+    bool intersects(const uint64_t* other, int n) const
+    {
+        const uint64_t* a = words();
+        if (n > m_nWords)
+            n = m_nWords;
+        for (int i = 0; i < n; i++)
+            if (a[i] & other[i])
+                return true;
+        return false;
+    }
+
+    void add(const uint64_t* other, int n)
+    {
+        if (n > m_nWords)
+            resize(n);
+        uint64_t* a = words();
+        for (int i = 0; i < n; i++)
+            a[i] |= other[i];
+    }
+
+    void subtract(const uint64_t* other, int n)
+    {
+        uint64_t* a = words();
+        if (n > m_nWords)
+            n = m_nWords;
+        for (int i = 0; i < n; i++)
+            a[i] &= ~other[i];
+    }
+
+      // the number of cells in both this set and other
+    int countAnd(const BasicBitboard& other) const
+    {
+        const uint64_t* a = words();
+        const uint64_t* b = other.words();
+        int n = (m_nWords < other.m_nWords ? m_nWords : other.m_nWords);
+        int count = 0;
+        for (int i = 0; i < n; i++)
+            count += popcount64(a[i] & b[i]);
+        return count;
+    }
+
+      // the number of cells in this set and not in other
+    int countExcept(const BasicBitboard& other) const
+    {
+        const uint64_t* a = words();
+        const uint64_t* b = other.words();
+        int n = 0;
+        for (int i = 0; i < m_nWords; i++)
+            n += popcount64(i < other.m_nWords ? a[i] & ~b[i] : a[i]);
+        return n;
+    }
+
+      // remove every cell of other from this set
+    BasicBitboard& subtract(const BasicBitboard& other)
+    {
+        uint64_t* a = words();
+        const uint64_t* b = other.words();
+        int n = (m_nWords < other.m_nWords ? m_nWords : other.m_nWords);
+        for (int i = 0; i < n; i++)
+            a[i] &= ~b[i];
+        return *this;
+    }
+
+    bool operator==(const BasicBitboard& other) const
+    {
+        const uint64_t* a = words();
+        const uint64_t* b = other.words();
+        int n = (m_nWords > other.m_nWords ? m_nWords : other.m_nWords);
+        for (int i = 0; i < n; i++)
+            if ((i < m_nWords ? a[i] : 0) != (i < other.m_nWords ? b[i] : 0))
+                return false;
+        return true;
+    }
+
+    bool operator!=(const BasicBitboard& other) const { return !(*this == other); }
+
+      // complement within the first nBits cells
+    BasicBitboard complement(int nBits) const
+    {
+        BasicBitboard result(nBits);
+        uint64_t* r = result.words();
+        const uint64_t* w = words();
+        for (int i = 0; i < result.m_nWords; i++)
+            r[i] = ~(i < m_nWords ? w[i] : 0);
+        result.trim(nBits);
+        return result;
+    }
+
+      // move every cell n places toward higher (<<) or lower (>>) numbers;
+      // the result has as many words as this set, and cells shifted past
+      // either end are dropped
+    BasicBitboard operator<<(int n) const
+    {
+        BasicBitboard result;
+        result.resize(m_nWords);
+        uint64_t* r = result.words();
+        const uint64_t* w = words();
+        int nw = n >> 6, bits = n & 63;
+        for (int i = m_nWords-1; i >= nw; i--)
+        {
+            uint64_t v = w[i - nw] << bits;
+            if (bits != 0  &&  i - nw - 1 >= 0)
+                v |= w[i - nw - 1] >> (64 - bits);
+            r[i] = v;
+        }
+        return result;
+    }
+
+    BasicBitboard operator>>(int n) const
+    {
+        BasicBitboard result;
+        result.resize(m_nWords);
+        uint64_t* r = result.words();
+        const uint64_t* w = words();
+        int nw = n >> 6, bits = n & 63;
+        for (int i = 0; i + nw < m_nWords; i++)
+        {
+            uint64_t v = w[i + nw] >> bits;
+            if (bits != 0  &&  i + nw + 1 < m_nWords)
+                v |= w[i + nw + 1] << (64 - bits);
+            r[i] = v;
+        }
+        return result;
+    }
+
+      // lowest-numbered cell in the set, or -1 if the set is empty
+    int first() const
+    {
+        const uint64_t* w = words();
+        for (int i = 0; i < m_nWords; i++)
+            if (w[i] != 0)
+                return i * 64 + __builtin_ctzll(w[i]);
+        return -1;
+    }
+
+      // the k-th lowest-numbered cell in the set (k from 0 to count()-1)
+    int select(int k) const
+    {
+        const uint64_t* w = words();
+        for (int i = 0; i < m_nWords; i++)
+        {
+            int n = popcount64(w[i]);
+            if (k < n)
+                return i * 64 + selectInWord(w[i], k);
+            k -= n;
+        }
+        return -1;
+    }
+
+  private:
+    friend class BitboardCounter;
+
+    uint64_t* words() { return m_nWords <= INLINE_WORDS ? m_inline : m_heap.data(); }
+    const uint64_t* words() const { return m_nWords <= INLINE_WORDS ? m_inline : m_heap.data(); }
+
+      // grow to n words, keeping the current cells
+    void resize(int n)
+    {
+        if (n <= m_nWords)
+            return;
+        if (n <= INLINE_WORDS)
+        {
+            for (int i = m_nWords; i < n; i++)
+                m_inline[i] = 0;
+        }
+        else
+        {
+            if (m_nWords <= INLINE_WORDS)
+                m_heap.assign(m_inline, m_inline + m_nWords);
+            m_heap.resize(n, 0);
+        }
+        m_nWords = n;
+    }
+
+      // drop any cells numbered nBits or higher
+    void trim(int nBits)
+    {
+        uint64_t* w = words();
+        for (int i = 0; i < m_nWords; i++)
+        {
+            if (i * 64 >= nBits)
+                w[i] = 0;
+            else if (i * 64 + 64 > nBits)
+                w[i] &= (uint64_t(1) << (nBits - i * 64)) - 1;
+        }
+    }
+
+    int m_nWords;
+    uint64_t m_inline[INLINE_WORDS];
+    std::vector<uint64_t> m_heap;   // used only past INLINE_WORDS words
+};
+
+template <int N>
+inline BasicBitboard<N> operator|(BasicBitboard<N> a, const BasicBitboard<N>& b) { return a |= b; }
+template <int N>
+inline BasicBitboard<N> operator&(BasicBitboard<N> a, const BasicBitboard<N>& b) { return a &= b; }
+
+// The standard 10 x 10 board fits in the inline storage
+typedef BasicBitboard<10 * 10> Bitboard;
+
+// A counter for every cell, stored bit-sliced: plane i holds bit i of each
+// cell's count.  Adding a whole Bitboard (1 to every cell in it) is a
+// ripple-carry add done a word at a time, and finding the cells with the
+// largest count needs no per-cell work at all.  Counts are kept modulo
+// 2^NPLANES, so a caller must keep them to MAXCOUNT.
+class BitboardCounter
+{
+  public:
+    static constexpr int NPLANES = 16;
+    static constexpr int MAXCOUNT = (1 << NPLANES) - 1;
+
+    BitboardCounter() { clear(); }
+
+    void clear()
+    {
+        for (int i = 0; i < NPLANES; i++)
+            m_planes[i].clear();
+    }
+
+      // add 2^weightLog2 to the count of every cell in cells, a word at a
+      // time, in place
+    void add(const Bitboard& cells, int weightLog2 = 0)
+    {
+        int n = cells.m_nWords;
+        const uint64_t* c = cells.words();
+        for (int i = weightLog2; i < NPLANES; i++)
+            m_planes[i].resize(n);
+        for (int w = 0; w < n; w++)
+        {
+            uint64_t carry = c[w];
+            for (int i = weightLog2; i < NPLANES  &&  carry != 0; i++)
+            {
+                uint64_t& plane = m_planes[i].words()[w];
+                uint64_t next = plane & carry;
+                plane ^= carry;
+                carry = next;
+            }
+        }
+    }
+
+      // take 2^weightLog2 from the count of every cell in cells, none of
+      // which may have a smaller count
+    void subtract(const Bitboard& cells, int weightLog2 = 0)
+    {
+        int n = cells.m_nWords;
+        const uint64_t* c = cells.words();
+        for (int i = weightLog2; i < NPLANES; i++)
+            m_planes[i].resize(n);
+        for (int w = 0; w < n; w++)
+        {
+            uint64_t borrow = c[w];
+            for (int i = weightLog2; i < NPLANES  &&  borrow != 0; i++)
+            {
+                uint64_t& plane = m_planes[i].words()[w];
+                uint64_t next = ~plane & borrow;
+                plane ^= borrow;
+                borrow = next;
+            }
+        }
+    }
+
+    void add(const BitboardCounter& other)
+    {
+        for (int i = 0; i < NPLANES; i++)
+            add(other.m_planes[i], i);
+    }
+
+    int count(int cell) const
+    {
+        int n = 0;
+        for (int i = NPLANES-1; i >= 0; i--)
+            n = 2 * n + m_planes[i].test(cell);
+        return n;
+    }
+
+      // the cells of among whose count is largest
+    Bitboard maxCells(const Bitboard& among) const
+    {
+        Bitboard best = among;
+        for (int i = NPLANES-1; i >= 0; i--)
+        {
+            Bitboard withBit = best & m_planes[i];
+            if (withBit.any())
+                best = withBit;
+        }
+        return best;
+    }
+
+  private:
+    Bitboard m_planes[NPLANES];
+};
+
+#endif // BITBOARD_INCLUDED
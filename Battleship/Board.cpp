@@ -1,13 +1,17 @@
 #include "Board.h"
 #include "Game.h"
 #include "globals.h"
+#include "Bitboard.h"
+#include "Arena.h"
+#include "PlacementMasks.h"
 #include <iostream>
 #include <vector>
+#include <string>
 #include <algorithm>
 
 using namespace std;
 
-class BoardImpl
+class BoardImpl : public ArenaObject
 {
   public:
     BoardImpl(const Game& g);
@@ -17,226 +21,269 @@ class BoardImpl
     bool placeShip(Point topOrLeft, int shipId, Direction dir);
     bool unplaceShip(Point topOrLeft, int shipId, Direction dir);
     void display(bool shotsOnly) const;
-    bool attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId);
+    void render(string& out, bool shotsOnly) const;
+    char symbolAt(Point p, bool shotsOnly) const { return cellSymbol(cellOf(p), shotsOnly); }
+    ShotResult attack(Point p);
+    void attackBatch(Span<const Point> shots, Span<ShotResult> results);
     bool allShipsDestroyed() const;
+    bool shipPlacement(int shipId, Point& topOrLeft, Direction& dir) const;
 
   private:
-      // TODO:  Decide what private members you need.  Here's one that's likely
-      //        to be useful:
+    int cellOf(Point p) const { return p.r * m_game.cols() + p.c; }
+    char cellSymbol(int cell, bool shotsOnly) const;
+    bool fits(Point topOrLeft, int shipId, Direction dir) const;
+
     const Game& m_game;
-    char m_board[MAXROWS][MAXCOLS];
-    vector<int> placedShip;
-    vector<char> demagedShip;
+    PlacementMasks m_masks;         // empty unless the board's size has a table
+    Bitboard m_ships;               // cells covered by any placed ship
+    Bitboard m_blocked;             // cells made unavailable by block()
+    Bitboard m_shots;               // cells that have been attacked
+    Bitboard m_hits;                // attacked cells that held a ship segment
+    GameVector<signed char> m_shipAt;   // shipId at each cell (row-major), or -1
+    GameVector<Point> m_shipStart;  // where each placed ship is
+    GameVector<Direction> m_shipDir;
+    GameVector<int> m_hitsLeft;     // unhit segments of each placed ship
+    GameVector<bool> m_placed;
+    int m_segmentsLeft;             // unhit segments over all placed ships
+    mutable string m_frame;         // display's output buffer
 };
 
 BoardImpl::BoardImpl(const Game& g)
- : m_game(g)
+ : m_game(g), m_masks(placementMasks(g.rows(), g.cols())),
+   m_ships(g.rows()*g.cols()), m_blocked(g.rows()*g.cols()),
+   m_shots(g.rows()*g.cols()), m_hits(g.rows()*g.cols())
 {
-    for (int i = 0; i < m_game.rows(); i++)
-    {
-        for (int j = 0; j < m_game.cols(); j++)
-            m_board[i][j] = '.';
-    }
+    clear();
 }
 
-// clear our board by making it all '.'
+// clear our board by removing all ships, blocks and shots
 void BoardImpl::clear()
 {
-    for (int i = 0; i < m_game.rows(); i++)
-    {
-        for (int j=0; j<m_game.cols(); j++)
-        {
-            m_board[i][j] = '.';
-        }
-    }
+    m_ships.clear();
+    m_blocked.clear();
+    m_shots.clear();
+    m_hits.clear();
+    m_shipAt.assign(m_game.rows()*m_game.cols(), -1);
+    m_shipStart.assign(m_game.nShips(), Point());
+    m_shipDir.assign(m_game.nShips(), HORIZONTAL);
+    m_hitsLeft.assign(m_game.nShips(), 0);
+    m_placed.assign(m_game.nShips(), false);
+    m_segmentsLeft = 0;
 }
 
-// block half of the board using #
+// block half of the board
 void BoardImpl::block()
 {
     for (int i=0; i<m_game.rows()*m_game.cols()/2; i++)
     {
-        Point p = m_game.randomPoint();
-        if (m_board[p.r][p.c] == '#')
+        int cell = cellOf(m_game.randomPoint());
+        if (m_blocked.test(cell))
             i--;
         else
-            m_board[p.r][p.c] = '#';
+            m_blocked.set(cell);
     }
 }
 
 // unblock the board
 void BoardImpl::unblock()
 {
-    for (int i=0; i<m_game.rows(); i++)
+    m_blocked.clear();
+}
+
+// return whether a ship would lie on the board without touching another
+// ship or a blocked cell
+bool BoardImpl::fits(Point topOrLeft, int shipId, Direction dir) const
+{
+    int len = m_game.shipLength(shipId);
+    if (m_masks.covers(len))
     {
-        for (int j=0; j<m_game.cols(); j++)
-        {
-            if (m_board[i][j] == '#')
-                m_board[i][j] = '.';
-        }
+        if (!m_game.isValid(topOrLeft))
+            return false;
+        int start = cellOf(topOrLeft);
+        if (((m_masks.starts(len, dir)[start >> 6] >> (start & 63)) & 1) == 0)
+            return false;
+        const uint64_t* mask = m_masks.mask(len, dir, start);
+        return !m_ships.intersects(mask, m_masks.nWords())  &&
+               !m_blocked.intersects(mask, m_masks.nWords());
     }
+
+    Point last = (dir == HORIZONTAL ? Point(topOrLeft.r, topOrLeft.c+len-1)
+                                    : Point(topOrLeft.r+len-1, topOrLeft.c));
+    if (!m_game.isValid(topOrLeft) || !m_game.isValid(last))
+        return false;
+
+    int cell = cellOf(topOrLeft);
+    int step = (dir == HORIZONTAL ? 1 : m_game.cols());
+    for (int i=0; i<len; i++, cell += step)
+    {
+        if (m_ships.test(cell) || m_blocked.test(cell))
+            return false;
+    }
+    return true;
 }
 
 // place ships on the board and return true if can be placed, false otherwise
 bool BoardImpl::placeShip(Point topOrLeft, int shipId, Direction dir)
 {
-
     if (shipId <0 || shipId >= m_game.nShips())
     {
         return false;
     }
-    
-    for (int i=0; i<m_game.shipLength(shipId); i++)
+    if (shipId >= (int)m_placed.size())
     {
-        if (dir==HORIZONTAL)
-        {
-            Point p = Point(topOrLeft.r, topOrLeft.c+i);
-            if (!m_game.isValid(p) || m_board[topOrLeft.r][topOrLeft.c+i] != '.')
-            {
-                return false;
-            }
-        }
-        else
-        {
-            Point p = Point(topOrLeft.r+i, topOrLeft.c);
-            if (!m_game.isValid(p) || m_board[topOrLeft.r+i][topOrLeft.c] != '.')
-            {
-                return false;
-            }
-        }
+        m_shipStart.resize(m_game.nShips());
+        m_shipDir.resize(m_game.nShips(), HORIZONTAL);
+        m_hitsLeft.resize(m_game.nShips(), 0);
+        m_placed.resize(m_game.nShips(), false);
     }
-    
-    vector<int>::iterator iter = find (placedShip.begin(), placedShip.end(), shipId);
 
-    if (iter != placedShip.end())
+    if (m_placed[shipId] || !fits(topOrLeft, shipId, dir))
     {
         return false;
     }
-    
-    for (int i=0; i<m_game.shipLength(shipId); i++)
+
+    int cell = cellOf(topOrLeft);
+    int step = (dir == HORIZONTAL ? 1 : m_game.cols());
+    for (int i=0; i<m_game.shipLength(shipId); i++, cell += step)
     {
-        if (dir==HORIZONTAL)
-            m_board[topOrLeft.r][topOrLeft.c+i] = m_game.shipSymbol(shipId);
-        else
-            m_board[topOrLeft.r+i][topOrLeft.c] = m_game.shipSymbol(shipId);
+        m_shipAt[cell] = shipId;
+        m_ships.set(cell);
     }
-    
-    placedShip.push_back(shipId);
+
+    m_shipStart[shipId] = topOrLeft;
+    m_shipDir[shipId] = dir;
+    m_hitsLeft[shipId] = m_game.shipLength(shipId);
+    m_placed[shipId] = true;
+    m_segmentsLeft += m_game.shipLength(shipId);
     return true;
 }
 
 bool BoardImpl::unplaceShip(Point topOrLeft, int shipId, Direction dir)
 {
-    if (shipId <0 || shipId >= m_game.nShips())
+    if (shipId <0 || shipId >= (int)m_placed.size() || !m_placed[shipId])
     {
         return false;
     }
-    
-    for (int i=0; i<m_game.shipLength(shipId); i++)
-    {
-        if (dir==HORIZONTAL)
-        {
-            Point p = Point(topOrLeft.r, topOrLeft.c+i);
-            if (!m_game.isValid(p) || m_board[topOrLeft.r][topOrLeft.c+i]!=m_game.shipSymbol(shipId))
-                return false;
-        }
-        else
-        {
-            Point p = Point(topOrLeft.r+i, topOrLeft.c);
-            if (!m_game.isValid(p) || m_board[topOrLeft.r+i][topOrLeft.c]!=m_game.shipSymbol(shipId))
-                return false;
-        }
-    }
-    
-    vector<int>::iterator iter = find (placedShip.begin(), placedShip.end(), shipId);
 
-    if (iter == placedShip.end())
+    if (m_shipStart[shipId].r != topOrLeft.r || m_shipStart[shipId].c != topOrLeft.c ||
+        m_shipDir[shipId] != dir)
     {
         return false;
     }
-    
-    for (int i=0; i<m_game.shipLength(shipId); i++)
+
+    int cell = cellOf(topOrLeft);
+    int step = (dir == HORIZONTAL ? 1 : m_game.cols());
+    for (int i=0; i<m_game.shipLength(shipId); i++, cell += step)
     {
-        if (dir==HORIZONTAL)
-            m_board[topOrLeft.r][topOrLeft.c+i] = '.';
-        else
-            m_board[topOrLeft.r+i][topOrLeft.c] = '.';
+        m_shipAt[cell] = -1;
+        m_ships.reset(cell);
     }
-    
-    placedShip.erase(iter);
+
+    m_segmentsLeft -= m_hitsLeft[shipId];
+    m_hitsLeft[shipId] = 0;
+    m_placed[shipId] = false;
     return true;
 }
 
-void BoardImpl::display(bool shotsOnly) const
+// what display shows for a cell
+char BoardImpl::cellSymbol(int cell, bool shotsOnly) const
 {
-    cout << "  ";
+    if (m_hits.test(cell))
+        return 'X';
+    else if (m_shots.test(cell))
+        return 'o';
+    else if (m_blocked.test(cell))
+        return '#';
+    else if (!shotsOnly && m_shipAt[cell] >= 0)
+        return m_game.shipSymbol(m_shipAt[cell]);
+    else
+        return '.';
+}
+
+// append the board as display shows it to out
+void BoardImpl::render(string& out, bool shotsOnly) const
+{
+    out += "  ";
     for (int i=0; i<m_game.cols(); i++)
-        cout << i;
-    cout << '\n';
+        out += char('0' + i % 10);
+    out += '\n';
     
     for (int i=0; i<m_game.rows(); i++)
     {
-        for (int j=-1; j<m_game.cols(); j++)
-        {
-            if (j==-1)
-                cout << i << " ";
-            else if (shotsOnly && m_board[i][j] != 'X' && m_board[i][j] != 'o' && m_board[i][j] != '#')
-                cout << '.';
-            else
-                cout << m_board[i][j];
-        }
-        cout << '\n';
+        out += char('0' + i % 10);
+        out += ' ';
+        for (int j=0; j<m_game.cols(); j++)
+            out += cellSymbol(cellOf(Point(i, j)), shotsOnly);
+        out += '\n';
     }
 }
 
-bool BoardImpl::attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
+// build the whole board in one buffer and write it out at once, rather
+// than a character at a time.  The buffer is kept between calls, and is
+// only sized once the board is first shown, so it is allocated once at
+// most and a game that's never displayed doesn't pay for it.
+void BoardImpl::display(bool shotsOnly) const
+{
+    m_frame.reserve((m_game.rows()+1) * (m_game.cols()+3));
+    m_frame.clear();
+    render(m_frame, shotsOnly);
+    cout.write(m_frame.data(), m_frame.size());
+}
+
+// The ship segment, if any, is found by looking up the cell's shipId, and
+// the shot and hit are recorded as bits, so an attack costs a handful of
+// array accesses whatever the board's size
+ShotResult BoardImpl::attack(Point p)
 {
-    if (!m_game.isValid(p) || m_board[p.r][p.c] == 'X' || m_board[p.r][p.c] == 'o')
-        return false;
-    
-    if (m_board[p.r][p.c] == '.')
-    {
-        shotHit = false;
-        m_board[p.r][p.c] = 'o';
-        return true;
-    }
-    
-    demagedShip.push_back(m_board[p.r][p.c]);
-    shotHit = true;
-    
-    int n = (int) count(demagedShip.begin(), demagedShip.end(), m_board[p.r][p.c]);
-    
-    int i = 0;
-    for (; i<placedShip.size(); i++)
-    {
-        if (m_game.shipSymbol(placedShip[i]) == m_board[p.r][p.c])
-            break;
-    }
-    
-    if (m_game.shipLength(placedShip[i]) == n)
+    ShotResult result = { false, false, false, -1 };
+    if (!m_game.isValid(p))
+        return result;
+
+    int cell = cellOf(p);
+    if (m_shots.test(cell))
+        return result;
+    m_shots.set(cell);
+    result.valid = true;
+
+    int id = m_shipAt[cell];
+    if (id < 0)
+        return result;
+
+    result.hit = true;
+    m_hits.set(cell);
+    m_segmentsLeft--;
+    if (--m_hitsLeft[id] == 0)
     {
-        shipDestroyed = true;
-        shipId = placedShip[i];
+        result.destroyed = true;
+        result.shipId = id;
     }
-    
-    else
-        shipDestroyed = false;
-    
-    m_board[p.r][p.c] = 'X';
-    
-    return true;
+    return result;
+}
+
+// one call for the lot, with attack inlined into the loop; shots with no
+// room for their result are not made
+void BoardImpl::attackBatch(Span<const Point> shots, Span<ShotResult> results)
+{
+    size_t n = min(shots.size(), results.size());
+    for (size_t i = 0; i < n; i++)
+        results[i] = attack(shots[i]);
 }
 
 bool BoardImpl::allShipsDestroyed() const
 {
-    int total = 0;
-    for (int i=0; i<placedShip.size(); i++)
+    return m_segmentsLeft == 0;
+}
+
+// report where a ship was placed, or return false if it isn't on the board
+bool BoardImpl::shipPlacement(int shipId, Point& topOrLeft, Direction& dir) const
+{
+    if (shipId <0 || shipId >= (int)m_placed.size() || !m_placed[shipId])
     {
-        total += m_game.shipLength(placedShip[i]);
+        return false;
     }
-    if (total == demagedShip.size())
-        return true;
-    return false;
+    topOrLeft = m_shipStart[shipId];
+    dir = m_shipDir[shipId];
+    return true;
 }
 
 //******************** Board functions ********************************
@@ -284,12 +331,41 @@ void Board::display(bool shotsOnly) const
     m_impl->display(shotsOnly);
 }
 
+void Board::render(std::string& out, bool shotsOnly) const
+{
+    m_impl->render(out, shotsOnly);
+}
+
+char Board::symbolAt(Point p, bool shotsOnly) const
+{
+    return m_impl->symbolAt(p, shotsOnly);
+}
+
 bool Board::attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
 {
-    return m_impl->attack(p, shotHit, shipDestroyed, shipId);
+    ShotResult result = m_impl->attack(p);
+    shotHit = result.hit;
+    shipDestroyed = result.destroyed;
+    shipId = result.shipId;
+    return result.valid;
+}
+
+ShotResult Board::attack(Point p)
+{
+    return m_impl->attack(p);
+}
+
+void Board::attackBatch(Span<const Point> shots, Span<ShotResult> results)
+{
+    m_impl->attackBatch(shots, results);
 }
 
 bool Board::allShipsDestroyed() const
 {
     return m_impl->allShipsDestroyed();
 }
+
+bool Board::shipPlacement(int shipId, Point& topOrLeft, Direction& dir) const
+{
+    return m_impl->shipPlacement(shipId, topOrLeft, dir);
+}
@@ -2,6 +2,7 @@
 #define BOARD_INCLUDED
 
 #include "globals.h"
+#include <string>
 
 class Game;
 class BoardImpl;
@@ -17,8 +18,18 @@ class Board
     bool placeShip(Point topOrLeft, int shipId, Direction dir);
     bool unplaceShip(Point topOrLeft, int shipId, Direction dir);
     void display(bool shotsOnly) const;
+      // append what display would show to out
+    void render(std::string& out, bool shotsOnly) const;
+      // the character display shows for one cell
+    char symbolAt(Point p, bool shotsOnly) const;
     bool attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId);
+    ShotResult attack(Point p);
+      // attack each of shots in turn, as if by attack(shots[i]), putting
+      // the outcome in results[i]; a point attacked twice is invalid the
+      // second time, and shots past the end of results are not made
+    void attackBatch(Span<const Point> shots, Span<ShotResult> results);
     bool allShipsDestroyed() const;
+    bool shipPlacement(int shipId, Point& topOrLeft, Direction& dir) const;
       // We prevent a Board object from being copied or assigned
     Board(const Board&) = delete;
     Board& operator=(const Board&) = delete;
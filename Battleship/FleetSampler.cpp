@@ -0,0 +1,343 @@
+#include "FleetSampler.h"
+#include "Board.h"
+#include "Game.h"
+#include "globals.h"
+#include "Instrumentation.h"
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+FleetSampler::FleetSampler(const Game& g)
+ : m_game(g), m_solver(g), m_chosen(g.nShips()), m_maxTries(10000),
+   m_rejections(0), m_prepared(false), m_throughReady(false)
+{
+    m_placed.reserve(g.nShips());
+    m_isPlaced.resize(g.nShips());
+    for (int s = 0; s < m_game.nShips(); s++)
+        m_order.push_back(s);
+    sortOrder();
+}
+
+// drawing the longest ships first finds overlaps soonest; a fleet is
+// short, so a stable insertion sort does, without the buffer stable_sort
+// would allocate
+void FleetSampler::sortOrder()
+{
+    for (size_t i = 1; i < m_order.size(); i++)
+    {
+        int s = m_order[i];
+        size_t j = i;
+        for ( ; j > 0  &&  m_game.shipLength(m_order[j-1]) < m_game.shipLength(s); j--)
+            m_order[j] = m_order[j-1];
+        m_order[j] = s;
+    }
+}
+
+void FleetSampler::assignWeights(const double* cellWeights, size_t nCells)
+{
+      // emptying each length's weights, rather than the outer vector, keeps
+      // their memory for the next call
+    for (size_t len = 0; len < m_weights.size(); len++)
+        m_weights[len].clear();
+    m_prepared = false;
+    if (nCells == 0)
+        return;
+
+    for (int s = 0; s < m_game.nShips(); s++)
+    {
+        int len = m_game.shipLength(s);
+        if (len < (int)m_weights.size()  &&  !m_weights[len].empty())
+            continue;
+        if (len >= (int)m_weights.size())
+            m_weights.resize(len+1);
+
+        const GameVector<Placement>& all = m_solver.placements(len);
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            double w = 1;
+            for (int k = 0, cell = all[i].first; k < len; k++, cell += all[i].step)
+                w *= cellWeights[cell];
+            m_weights[len].push_back(w);
+        }
+    }
+}
+
+// work out which placements of each length avoid the forbidden cells, so
+// the draws never have to reject a ship for touching one
+void FleetSampler::prepare(const Bitboard& forbidden)
+{
+    if (m_prepared  &&  forbidden == m_forbidden)
+        return;
+    m_forbidden = forbidden;
+    m_prepared = true;
+    m_throughReady = false;
+
+    for (int s = 0; s < m_game.nShips(); s++)
+    {
+        int len = m_game.shipLength(s);
+        if (len >= (int)m_candidates.size())
+        {
+            m_candidates.resize(len+1);
+            m_cumulative.resize(len+1);
+        }
+        m_candidates[len].clear();
+        m_cumulative[len].clear();
+
+        bool weighted = len < (int)m_weights.size()  &&  !m_weights[len].empty();
+        const GameVector<Placement>& all = m_solver.placements(len);
+        double total = 0;
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            if (all[i].overlaps(forbidden))
+                continue;
+            m_candidates[len].push_back((int)i);
+            if (weighted)
+            {
+                total += m_weights[len][i];
+                m_cumulative[len].push_back(total);
+            }
+        }
+    }
+}
+
+// index each length's candidates by the cells they cover, as lists laid
+// end to end with the start of each cell's list, so drawCovering can find
+// the placements through a cell without looking at the others
+void FleetSampler::prepareThrough()
+{
+    if (m_throughReady)
+        return;
+    m_throughReady = true;
+    int nCells = m_game.rows() * m_game.cols();
+    m_through.resize(m_candidates.size());
+    m_throughStart.resize(m_candidates.size());
+    for (size_t len = 0; len < m_candidates.size(); len++)
+    {
+        GameVector<int>& start = m_throughStart[len];
+        GameVector<int>& through = m_through[len];
+        start.assign(nCells + 1, 0);
+        if (m_candidates[len].empty())
+        {
+            through.clear();
+            continue;
+        }
+        const GameVector<Placement>& all = m_solver.placements((int)len);
+        for (size_t i = 0; i < m_candidates[len].size(); i++)
+        {
+            const Placement& ship = all[m_candidates[len][i]];
+            for (int k = 0, cell = ship.first; k < ship.length; k++, cell += ship.step)
+                start[cell + 1]++;
+        }
+        for (int cell = 0; cell < nCells; cell++)
+            start[cell + 1] += start[cell];
+        through.resize(start[nCells]);
+        for (size_t i = 0; i < m_candidates[len].size(); i++)
+        {
+            const Placement& ship = all[m_candidates[len][i]];
+            for (int k = 0, cell = ship.first; k < ship.length; k++, cell += ship.step)
+                through[start[cell]++] = m_candidates[len][i];
+        }
+          // filling each list moved its start to the next one's
+        for (int cell = nCells; cell > 0; cell--)
+            start[cell] = start[cell - 1];
+        start[0] = 0;
+    }
+}
+
+int FleetSampler::drawPlacement(Rng& rng, int len)
+{
+    const GameVector<int>& candidates = m_candidates[len];
+    const GameVector<double>& cum = m_cumulative[len];
+    if (cum.empty())
+        return candidates[rng.randInt((int)candidates.size())];
+
+    double x = rng.uniform() * cum.back();
+    int i = (int)(upper_bound(cum.begin(), cum.end(), x) - cum.begin());
+    return candidates[min(i, (int)cum.size() - 1)];
+}
+
+bool FleetSampler::drawOne(Rng& rng, const Bitboard& forbidden, Bitboard& cells, int* chosen)
+{
+    prepare(forbidden);
+    for (size_t i = 0; i < m_order.size(); i++)
+        if (m_candidates[m_game.shipLength(m_order[i])].empty())
+            return false;
+
+    cells.clear();
+    for (int t = 0; t < m_maxTries; t++)
+    {
+        size_t i;
+        for (i = 0; i < m_order.size(); i++)
+        {
+            int s = m_order[i];
+            int len = m_game.shipLength(s);
+            int j = drawPlacement(rng, len);
+            const Placement& ship = m_solver.placements(len)[j];
+            if (ship.overlaps(cells))
+                break;
+            ship.addTo(cells);
+            chosen[s] = j;
+        }
+        if (i == m_order.size())
+            return true;
+
+        m_rejections++;
+
+          // take back the ships drawn so far (clearing the whole set would
+          // cost a pass over every word of a large board)
+        for (size_t k = 0; k < i; k++)
+        {
+            int s = m_order[k];
+            m_solver.placements(m_game.shipLength(s))[chosen[s]].removeFrom(cells);
+        }
+    }
+    return false;
+}
+
+// list, as pairs of shipId and placement, the ways to put a ship not yet
+// placed through cell without overlapping cells
+void FleetSampler::gatherOptions(int cell, const Bitboard& cells, GameVector<int>& options) const
+{
+    options.clear();
+    for (size_t i = 0; i < m_order.size(); i++)
+    {
+        int s = m_order[i];
+        if (m_isPlaced[s])
+            continue;
+        int len = m_game.shipLength(s);
+        const GameVector<Placement>& all = m_solver.placements(len);
+        const int* through = m_through[len].data();
+        for (int j = m_throughStart[len][cell]; j < m_throughStart[len][cell+1]; j++)
+        {
+            if (!all[through[j]].overlaps(cells))
+            {
+                options.push_back(s);
+                options.push_back(through[j]);
+            }
+        }
+    }
+}
+
+// one try at a layout covering mustCover; cells must start out empty, and
+// is left empty if the try fails
+bool FleetSampler::drawCovering(Rng& rng, const Bitboard& mustCover, Bitboard& cells)
+{
+    Bitboard uncovered = mustCover;
+    m_placed.clear();
+    for (size_t i = 0; i < m_order.size(); i++)
+        m_isPlaced[m_order[i]] = false;
+    bool ok = true;
+    for (int cell = uncovered.first(); ok  &&  cell >= 0; cell = uncovered.first())
+    {
+          // the first ship's choices are the same on every try
+        const GameVector<int>& options = (m_placed.empty() ? m_firstOptions : m_options);
+        if (!m_placed.empty())
+            gatherOptions(cell, cells, m_options);
+        ok = !options.empty();
+        if (ok)
+        {
+            int k = 2 * rng.randInt((int)options.size() / 2);
+            int s = options[k];
+            const Placement& ship = m_solver.placements(m_game.shipLength(s))[options[k+1]];
+            ship.addTo(cells);
+            ship.removeFrom(uncovered);
+            m_chosen[s] = options[k+1];
+            m_isPlaced[s] = true;
+            m_placed.push_back(s);
+        }
+    }
+
+    for (size_t i = 0; ok  &&  i < m_order.size(); i++)
+    {
+        int s = m_order[i];
+        if (m_isPlaced[s])
+            continue;
+        int len = m_game.shipLength(s);
+        int j = drawPlacement(rng, len);
+        const Placement& ship = m_solver.placements(len)[j];
+        ok = !ship.overlaps(cells);
+        if (ok)
+        {
+            ship.addTo(cells);
+            m_chosen[s] = j;
+            m_placed.push_back(s);
+        }
+    }
+    if (ok)
+        return true;
+
+    for (size_t i = 0; i < m_placed.size(); i++)
+    {
+        int s = m_placed[i];
+        m_solver.placements(m_game.shipLength(s))[m_chosen[s]].removeFrom(cells);
+    }
+    return false;
+}
+
+int FleetSampler::sampleCovering(Rng& rng, int n, const Bitboard& forbidden,
+                                 const Bitboard& mustCover, vector<Bitboard>& occupancy)
+{
+    prepare(forbidden);
+    prepareThrough();
+    for (size_t i = 0; i < m_order.size(); i++)
+        if (m_candidates[m_game.shipLength(m_order[i])].empty())
+            return 0;
+    for (size_t i = 0; i < m_order.size(); i++)
+        m_isPlaced[m_order[i]] = false;
+    if (mustCover.any())
+        gatherOptions(mustCover.first(), Bitboard(), m_firstOptions);
+
+    Bitboard cells;
+    for (int k = 0; k < n; k++)
+    {
+        int t;
+        for (t = 0; t < m_maxTries  &&  !drawCovering(rng, mustCover, cells); t++)
+            m_rejections++;
+        if (t == m_maxTries)
+            return k;
+        occupancy.push_back(cells);
+        cells.clear();
+    }
+    return n;
+}
+
+bool FleetSampler::sample(Rng& rng, const Bitboard& forbidden, GameVector<Placement>& fleet)
+{
+    Bitboard cells;
+    if (!drawOne(rng, forbidden, cells, m_chosen.data()))
+        return false;
+    fleet.resize(m_game.nShips());
+    for (size_t i = 0; i < m_order.size(); i++)
+    {
+        int s = m_order[i];
+        fleet[s] = m_solver.placements(m_game.shipLength(s))[m_chosen[s]];
+    }
+    return true;
+}
+
+int FleetSampler::sampleBatch(Rng& rng, int n, const Bitboard& forbidden,
+                              vector<Bitboard>& occupancy, vector<int>* placements)
+{
+    Bitboard cells;
+    for (int k = 0; k < n; k++)
+    {
+        if (!drawOne(rng, forbidden, cells, m_chosen.data()))
+            return k;
+        occupancy.push_back(cells);
+        if (placements != nullptr)
+            placements->insert(placements->end(), m_chosen.begin(), m_chosen.end());
+    }
+    return n;
+}
+
+bool FleetSampler::placeFleet(Board& b, Rng& rng)
+{
+    long before = m_rejections;
+    bool sampled = sample(rng, Bitboard(), m_fleet);
+    BS_COUNT(COUNTER_PLACEMENT_RETRIES, m_rejections - before);
+    if (sampled)
+        return m_solver.place(b, m_fleet);
+    BS_COUNT(COUNTER_PLACEMENT_FALLBACKS, 1);
+    return m_solver.placeFleet(b, rng);
+}
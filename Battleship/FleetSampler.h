@@ -0,0 +1,112 @@
+#ifndef FLEETSAMPLER_INCLUDED
+#define FLEETSAMPLER_INCLUDED
+
+#include "globals.h"
+#include "Bitboard.h"
+#include "PlacementSolver.h"
+#include <vector>
+
+class Game;
+class Board;
+
+// Draws random fleet layouts.  By default every legal layout (no two ships
+// overlapping, none on a forbidden cell) is equally likely.  Giving each
+// cell a weight makes a layout's probability proportional instead to the
+// product of the weights of the cells its ships cover.
+//
+// Each ship's placement is drawn independently from the precomputed
+// placements for its length that avoid the forbidden cells, and the whole
+// layout is rejected as soon as two ships overlap.  Because a rejected
+// layout is thrown away entirely, the accepted ones have exactly the
+// distribution above.
+class FleetSampler
+{
+  public:
+    FleetSampler(const Game& g);
+
+      // use these cell weights (one per cell, in row-major order, in a
+      // vector or GameVector); an empty one means every cell weighs the
+      // same.  New weights are written over the old ones, so reweighting
+      // between games doesn't allocate.
+    template <class CellWeights>
+    void setWeights(const CellWeights& cellWeights)
+    {
+        assignWeights(cellWeights.data(), cellWeights.size());
+    }
+
+      // only place these ships (all of them unless this is called); the
+      // others are left out of sampled layouts
+    template <class ShipIds>
+    void setShips(const ShipIds& shipIds)
+    {
+        m_order.assign(shipIds.begin(), shipIds.end());
+        sortOrder();
+    }
+
+      // give up on a layout after this many rejected draws
+    void setMaxTries(int maxTries) { m_maxTries = maxTries; }
+
+      // draw one layout avoiding the forbidden cells into fleet (indexed by
+      // shipId; entries for ships left out by setShips are untouched);
+      // return false if none was found within the try budget
+    bool sample(Rng& rng, const Bitboard& forbidden, GameVector<Placement>& fleet);
+
+      // draw up to n layouts, appending the cells each one covers to
+      // occupancy, and (if placements isn't null) the index of every ship's
+      // placement, nShips per layout; return how many were drawn
+    int sampleBatch(Rng& rng, int n, const Bitboard& forbidden,
+                    std::vector<Bitboard>& occupancy,
+                    std::vector<int>* placements = nullptr);
+
+      // like sampleBatch, but every layout covers each cell of mustCover.
+      // While some cell of it is uncovered, a ship is drawn together with
+      // its placement, uniformly from the placements of the ships still to
+      // be placed that go through the lowest such cell; the other ships
+      // are then drawn as usual (and only they follow the cell weights).
+      // So no layout leaving a cell uncovered is ever drawn, though
+      // layouts that cover mustCover in fewer ways come up more often than
+      // others.
+    int sampleCovering(Rng& rng, int n, const Bitboard& forbidden,
+                       const Bitboard& mustCover, std::vector<Bitboard>& occupancy);
+
+      // place the fleet on an empty board at random, falling back to the
+      // placement solver if sampling keeps failing (very crowded boards)
+    bool placeFleet(Board& b, Rng& rng);
+
+    const PlacementSolver& solver() const { return m_solver; }
+
+      // layouts drawn and thrown away for overlapping, over all calls
+    long rejections() const { return m_rejections; }
+
+  private:
+    void assignWeights(const double* cellWeights, size_t nCells);
+    void sortOrder();
+    void prepare(const Bitboard& forbidden);
+    bool drawOne(Rng& rng, const Bitboard& forbidden, Bitboard& cells, int* chosen);
+    void gatherOptions(int cell, const Bitboard& cells, GameVector<int>& options) const;
+    bool drawCovering(Rng& rng, const Bitboard& mustCover, Bitboard& cells);
+    int drawPlacement(Rng& rng, int len);
+    void prepareThrough();
+
+    const Game& m_game;
+    PlacementSolver m_solver;
+    GameVector<int> m_order;        // shipIds to place, longest first
+    GameVector<GameVector<double> > m_weights;     // per length and placement; empty if uniform
+    GameVector<GameVector<int> > m_candidates;     // per length: placements clear of m_forbidden
+    GameVector<GameVector<double> > m_cumulative;  // per length: running total of the candidates' weights
+    GameVector<GameVector<int> > m_through;        // per length: the candidates through
+    GameVector<GameVector<int> > m_throughStart;   //   each cell, where they start
+    GameVector<int> m_options;      // drawCovering's choices: shipId, placement
+    GameVector<int> m_firstOptions; // ... for the first ship, made once per call
+    GameVector<int> m_chosen;
+    GameVector<int> m_placed;       // shipIds in the order drawCovering placed them
+    GameVector<char> m_isPlaced;    // per shipId: whether drawCovering has placed it
+    GameVector<Placement> m_fleet;  // placeFleet's layout, kept for the next game
+    int m_maxTries;
+    long m_rejections;
+    bool m_prepared;                // m_candidates is up to date for m_forbidden
+    bool m_throughReady;            // ... and so is m_through
+    Bitboard m_forbidden;
+};
+
+#endif // FLEETSAMPLER_INCLUDED
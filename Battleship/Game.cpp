@@ -1,16 +1,21 @@
 #include "Game.h"
 #include "Board.h"
 #include "Player.h"
+#include "GameEvents.h"
+#include "Arena.h"
 #include "globals.h"
 #include <iostream>
 #include <string>
+#include <vector>
+#include <utility>
+#include <optional>
 #include <cstdlib>
 #include <cctype>
 
 using namespace std;
 
 
-class GameImpl
+class GameImpl : public ArenaObject
 {
 public:
     GameImpl(int nRows, int nCols);
@@ -18,24 +23,37 @@ public:
     int cols() const;
     bool isValid(Point p) const;
     Point randomPoint() const;
-    bool addShip(int length, char symbol, string name);
+    void seed(uint64_t s);
+    uint64_t seed() const;
+    Rng& rng() const;
+    bool addShip(int length, char symbol, const string& name);
     int nShips() const;
     int shipLength(int shipId) const;
     char shipSymbol(int shipId) const;
     string shipName(int shipId) const;
-    Player* play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause);
+    void setAnsiDisplay(bool on);
+    bool ansiDisplay() const;
+      // the boards games are played on, made the first time they're needed
+      // and kept for every game after
+    Board& board(int i, const Game& g);
+    template <class Sink>
+    Player* run(Player* p1, Player* p2, Board& b1, Board& b2, Sink& sink, GameResult& result);
     
 private:
     struct ship
     {
-        ship(int l, char s, string n):  length(l), symbol(s), name(n){}
+        ship(int l, char s, const string& n):  length(l), symbol(s), name(n.data(), n.size()){}
         int length;
         char symbol;
-        string name;
+        GameString name;
     };
     int row;
     int col;
-    vector<ship> shipvec;
+    GameVector<ship> shipvec;
+    uint64_t m_seed;
+    mutable Rng m_rng;
+    bool m_ansi;
+    optional<Board> m_boards[2];
 };
 
 void waitForEnter()
@@ -44,10 +62,14 @@ void waitForEnter()
     cin.ignore(10000, '\n');
 }
 
+// each game draws its seed from the creating thread's generator, so seeding
+// that thread makes a whole run of games reproducible
 GameImpl::GameImpl(int nRows, int nCols)
 {
     row = nRows;
     col = nCols;
+    m_ansi = false;
+    seed(threadRng().next());
 }
 
 int GameImpl::rows() const
@@ -67,10 +89,45 @@ bool GameImpl::isValid(Point p) const
 
 Point GameImpl::randomPoint() const
 {
-    return Point(randInt(rows()), randInt(cols()));
+    return Point(m_rng.randInt(rows()), m_rng.randInt(cols()));
 }
 
-bool GameImpl::addShip(int length, char symbol, string name)
+void GameImpl::seed(uint64_t s)
+{
+    m_seed = s;
+    m_rng.seed(s);
+}
+
+uint64_t GameImpl::seed() const
+{
+    return m_seed;
+}
+
+Rng& GameImpl::rng() const
+{
+    return m_rng;
+}
+
+void GameImpl::setAnsiDisplay(bool on)
+{
+    m_ansi = on;
+}
+
+bool GameImpl::ansiDisplay() const
+{
+    return m_ansi;
+}
+
+// a board can't be made along with the GameImpl, since it asks the Game
+// (which isn't finished yet) how big to be
+Board& GameImpl::board(int i, const Game& g)
+{
+    if (!m_boards[i])
+        m_boards[i].emplace(g);
+    return *m_boards[i];
+}
+
+bool GameImpl::addShip(int length, char symbol, const string& name)
 {
     shipvec.push_back(ship(length, symbol, name));
     return true;
@@ -93,107 +150,97 @@ char GameImpl::shipSymbol(int shipId) const
 
 string GameImpl::shipName(int shipId) const
 {
-    return shipvec[shipId].name;
+    return string(shipvec[shipId].name.data(), shipvec[shipId].name.size());
 }
 
-Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause = true)
+// play a game, telling sink what happens in it.  Sink is GameEventSink for
+// whatever listener the caller plugs in, or NullSink for a game nobody is
+// watching, in which case every call to it compiles away.  Nothing here
+// allocates memory unless the sink does.
+template <class Sink>
+Player* GameImpl::run(Player* p1, Player* p2, Board& b1, Board& b2, Sink& sink,
+                      GameResult& result)
 {
+    result.winner = 0;
+    result.turns = 0;
+    result.shots[0] = result.shots[1] = 0;
+    result.stats[0].clear();
+    result.stats[1].clear();
+
     b1.clear();
     b2.clear();
     
-    if (!p1->placeShips(b1) || !p2->placeShips(b2))
+    bool placed;
+    {
+        BS_PLAYER_SCOPE(&result.stats[0]);
+        BS_TIME_PHASE(&result.stats[0], PHASE_PLACE_SHIPS);
+        placed = p1->placeShips(b1);
+    }
+    if (placed)
+    {
+        sink.onPlacement(0, *p1, b1);
+        BS_PLAYER_SCOPE(&result.stats[1]);
+        BS_TIME_PHASE(&result.stats[1], PHASE_PLACE_SHIPS);
+        placed = p2->placeShips(b2);
+    }
+    if (!placed)
     {
         return nullptr;
     }
+    sink.onPlacement(1, *p2, b2);
     
-    int round = 0;
+    Player* attacker = p1;
+    Player* defender = p2;
+    Board* home = &b1;
+    Board* target = &b2;
+    int side = 0;
     
     while(true)
     {
-        if (round%2==0)
+        sink.onTurn(side, *attacker, *defender, *target);
+        Point attack;
+        ShotResult shot;
         {
-            cout << p1->name() << "'s turn. Board for " << p2->name() << ":" << '\n';
-            b2.display(p1->isHuman());
-            bool shotHit, shipDestroyed;
-            int shipId;
-            Point attack = p1->recommendAttack();
-            bool validShot = b2.attack(attack, shotHit, shipDestroyed, shipId);
-            p1->recordAttackResult(attack, validShot, shotHit, shipDestroyed, shipId);
-            p2->recordAttackByOpponent(attack);
-            if (!validShot)
-                cout << p1->name() << " wasted a shot at (" << attack.r << "," << attack.c << "). \n";
-            else if (!shotHit)
+            BS_PLAYER_SCOPE(&result.stats[side]);
             {
-                cout << p1->name() << " attacked (" << attack.r << "," << attack.c << ") and missed, resulting in: \n";
-                b2.display(p1->isHuman());
+                BS_TIME_PHASE(&result.stats[side], PHASE_RECOMMEND_ATTACK);
+                attack = attacker->recommendAttack();
             }
-            else if (shipDestroyed)
             {
-                cout << p1->name() << " attacked (" << attack.r << "," << attack.c << ") and destroyed the " << shipName(shipId) <<  ", resulting in: \n";
-                b2.display(p1->isHuman());
-
+                BS_TIME_PHASE(&result.stats[side], PHASE_BOARD_ATTACK);
+                shot = target->attack(attack);
             }
-            else
+            if (!shot.valid)
+                BS_COUNT(COUNTER_WASTED_SHOTS, 1);
             {
-                cout << p1->name() << " attacked (" << attack.r << "," << attack.c << ") and hit something, resulting in: \n";
-                b2.display(p1->isHuman());
+                BS_TIME_PHASE(&result.stats[side], PHASE_RECORD_ATTACK_RESULT);
+                attacker->recordAttackResult(attack, shot.valid, shot.hit, shot.destroyed, shot.shipId);
             }
         }
-        else
-        {
-            cout << p2->name() << "'s turn. Board for " << p1->name() << ":" << '\n';
-            b1.display(p2->isHuman());
-            bool shotHit, shipDestroyed;
-            int shipId;
-            Point attack = p2->recommendAttack();
-            bool validShot = b1.attack(attack, shotHit, shipDestroyed, shipId);
-            p2->recordAttackResult(attack, validShot, shotHit, shipDestroyed, shipId);
-            p1->recordAttackByOpponent(attack);
-            if (!validShot)
-                cout << p2->name() << " wasted a shot at (" << attack.r << "," << attack.c << "). \n";
-            else if (!shotHit)
-            {
-                cout << p2->name() << " attacked (" << attack.r << "," << attack.c << ") and missed, resulting in: \n";
-                b1.display(p2->isHuman());
-            }
-            else if (shipDestroyed)
-            {
-                cout << p2->name() << " attacked (" << attack.r << "," << attack.c << ") and destroyed the " << shipName(shipId) <<  ", resulting in: \n";
-                b1.display(p2->isHuman());
-            }
-            else
-            {
-                cout << p2->name() << " attacked (" << attack.r << "," << attack.c << ") and hit something, resulting in: \n";
-                b1.display(p2->isHuman());
-            }
-            
-        }
-        if (b2.allShipsDestroyed())
+        defender->recordAttackByOpponent(attack);
+        result.shots[side]++;
+        result.turns++;
+        sink.onAttack(side, *attacker, attack, shot.valid, shot.hit, shot.destroyed, shot.shipId, *target);
+
+        if (shot.destroyed)
         {
-            cout << p1->name() << " wins! \n";
-            if (p2->isHuman())
+            sink.onSink(side, *attacker, shot.shipId, *target);
+            if (target->allShipsDestroyed())
             {
-                cout << "Here is where "<< p1->name() << "'s ships were: \n";
-                b1.display(false);
+                result.winner = side + 1;
+                sink.onWin(side, *attacker, *defender, *home, *target);
+#ifdef BATTLESHIP_INSTRUMENT
+                recordPlayerStats(p1->type(), result.stats[0]);
+                recordPlayerStats(p2->type(), result.stats[1]);
+#endif
+                return attacker;
             }
-            return p1;
         }
-        if (b1.allShipsDestroyed())
-        {
-            cout << p2->name() << " wins! \n";
-            if (p1->isHuman())
-            {
-                cout << "Here is where "<< p2->name() << "'s ships were: \n";
-                b2.display(false);
-            }
 
-            return p2;
-        }
-        if (shouldPause)
-            waitForEnter();
-        round ++;
+        swap(attacker, defender);
+        swap(home, target);
+        side = 1 - side;
     }
-    
 }
 
 //******************** Game functions *******************************
@@ -203,14 +250,19 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
 
 Game::Game(int nRows, int nCols)
 {
-    if (nRows < 1  ||  nRows > MAXROWS)
+    if (nRows < 1)
     {
-        cout << "Number of rows must be >= 1 and <= " << MAXROWS << endl;
+        cout << "Number of rows must be >= 1" << endl;
         exit(1);
     }
-    if (nCols < 1  ||  nCols > MAXCOLS)
+    if (nCols < 1)
     {
-        cout << "Number of columns must be >= 1 and <= " << MAXCOLS << endl;
+        cout << "Number of columns must be >= 1" << endl;
+        exit(1);
+    }
+    if (nRows > MAXCELLS / nCols)
+    {
+        cout << "A board must have no more than " << MAXCELLS << " cells" << endl;
         exit(1);
     }
     m_impl = new GameImpl(nRows, nCols);
@@ -241,6 +293,26 @@ Point Game::randomPoint() const
     return m_impl->randomPoint();
 }
 
+void Game::seed(uint64_t s)
+{
+    m_impl->seed(s);
+}
+
+uint64_t Game::seed() const
+{
+    return m_impl->seed();
+}
+
+Rng& Game::rng() const
+{
+    return m_impl->rng();
+}
+
+void Game::setAnsiDisplay(bool on)
+{
+    m_impl->setAnsiDisplay(on);
+}
+
 bool Game::addShip(int length, char symbol, string name)
 {
     if (length < 1)
@@ -312,8 +384,63 @@ Player* Game::play(Player* p1, Player* p2, bool shouldPause)
 {
     if (p1 == nullptr  ||  p2 == nullptr  ||  nShips() == 0)
         return nullptr;
-    Board b1(*this);
-    Board b2(*this);
-    return m_impl->play(p1, p2, b1, b2, shouldPause);
+    ConsoleSink console(rows(), cols(), shouldPause, m_impl->ansiDisplay());
+    GameResult result;
+    return m_impl->run(p1, p2, m_impl->board(0, *this), m_impl->board(1, *this),
+                       console, result);
+}
+
+template <class Sink>
+Player* Game::playWith(Player* p1, Player* p2, GameResult& result, Sink& sink)
+{
+    if (p1 == nullptr  ||  p2 == nullptr  ||  nShips() == 0)
+    {
+        result.winner = 0;
+        result.turns = 0;
+        result.shots[0] = result.shots[1] = 0;
+        return nullptr;
+    }
+    return m_impl->run(p1, p2, m_impl->board(0, *this), m_impl->board(1, *this),
+                       sink, result);
+}
+
+Player* Game::play(Player* p1, Player* p2, GameResult& result,
+                   GameRecord* record)
+{
+    if (record == nullptr)
+    {
+        NullSink none;
+        return playWith(p1, p2, result, none);
+    }
+    RecordingSink recorder(*record);
+    return playWith<GameEventSink>(p1, p2, result, recorder);
+}
+
+Player* Game::play(Player* p1, Player* p2, GameResult& result, GameEventSink& sink)
+{
+    return playWith(p1, p2, result, sink);
 }
 
+Player* Game::rematch(Player* p1, Player* p2, uint64_t s, GameResult& result,
+                      GameRecord* record)
+{
+    if (p1 != nullptr  &&  p2 != nullptr)
+    {
+        seed(s);
+        p1->reset();
+        p2->reset();
+    }
+    return play(p1, p2, result, record);
+}
+
+Player* Game::rematch(Player* p1, Player* p2, uint64_t s, GameResult& result,
+                      GameEventSink& sink)
+{
+    if (p1 != nullptr  &&  p2 != nullptr)
+    {
+        seed(s);
+        p1->reset();
+        p2->reset();
+    }
+    return play(p1, p2, result, sink);
+}
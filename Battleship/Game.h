@@ -3,10 +3,25 @@
 
 #include <string>
 #include <cassert>
+#include <cstdint>
+#include "Instrumentation.h"
 
 class Point;
+class Rng;
 class Player;
 class GameImpl;
+struct GameRecord;
+class GameEventSink;
+
+// Outcome of a game played without console output
+struct GameResult
+{
+    int winner;     // 1 if p1 won, 2 if p2 won, 0 if the game was not played
+    int turns;      // attacks made by both players together
+    int shots[2];   // attacks made by p1 and by p2, including wasted ones
+    PlayerStats stats[2];   // for p1 and p2; all zero unless the program
+                            //   is built with BATTLESHIP_INSTRUMENT
+};
 
 class Game
 {
@@ -17,17 +32,40 @@ class Game
     int cols() const;
     bool isValid(Point p) const;
     Point randomPoint() const;
+    void seed(uint64_t s);
+    uint64_t seed() const;
+    Rng& rng() const;
+      // show games between computer players on a fixed ANSI terminal
+      // layout that is redrawn in place, instead of as scrolling text
+    void setAnsiDisplay(bool on);
     bool addShip(int length, char symbol, std::string name);
     int nShips() const;
     int shipLength(int shipId) const;
     char shipSymbol(int shipId) const;
     std::string shipName(int shipId) const;
+      // play on the console
     Player* play(Player* p1, Player* p2, bool shouldPause = true);
+      // play without output; if record isn't null, the game is also
+      // written into it
+    Player* play(Player* p1, Player* p2, GameResult& result,
+                 GameRecord* record = nullptr);
+      // play without output of its own, telling sink what happens
+    Player* play(Player* p1, Player* p2, GameResult& result, GameEventSink& sink);
+      // play p1 and p2 again with the game reseeded and the players reset,
+      // giving the same game as play() with everything newly made; the
+      // boards are reused too, so a run of rematches allocates nothing
+    Player* rematch(Player* p1, Player* p2, uint64_t seed, GameResult& result,
+                    GameRecord* record = nullptr);
+    Player* rematch(Player* p1, Player* p2, uint64_t seed, GameResult& result,
+                    GameEventSink& sink);
       // We prevent a Game object from being copied or assigned
     Game(const Game&) = delete;
     Game& operator=(const Game&) = delete;
 
   private:
+    template <class Sink>
+    Player* playWith(Player* p1, Player* p2, GameResult& result, Sink& sink);
+
     GameImpl* m_impl;
 };
 
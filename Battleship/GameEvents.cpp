@@ -0,0 +1,232 @@
+#include "GameEvents.h"
+#include "Game.h"
+#include "Board.h"
+#include "Player.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+void waitForEnter();
+
+//******************** SinkList functions ***************************
+
+void SinkList::onPlacement(int player, const Player& p, const Board& b)
+{
+    for (size_t k = 0; k < m_sinks.size(); k++)
+        m_sinks[k]->onPlacement(player, p, b);
+}
+
+void SinkList::onTurn(int player, const Player& attacker, const Player& defender,
+                      const Board& target)
+{
+    for (size_t k = 0; k < m_sinks.size(); k++)
+        m_sinks[k]->onTurn(player, attacker, defender, target);
+}
+
+void SinkList::onAttack(int player, const Player& attacker, Point p, bool validShot,
+                        bool shotHit, bool shipDestroyed, int shipId, const Board& target)
+{
+    for (size_t k = 0; k < m_sinks.size(); k++)
+        m_sinks[k]->onAttack(player, attacker, p, validShot, shotHit, shipDestroyed,
+                             shipId, target);
+}
+
+void SinkList::onSink(int player, const Player& attacker, int shipId, const Board& target)
+{
+    for (size_t k = 0; k < m_sinks.size(); k++)
+        m_sinks[k]->onSink(player, attacker, shipId, target);
+}
+
+void SinkList::onWin(int player, const Player& winner, const Player& loser,
+                     const Board& winnerBoard, const Board& loserBoard)
+{
+    for (size_t k = 0; k < m_sinks.size(); k++)
+        m_sinks[k]->onWin(player, winner, loser, winnerBoard, loserBoard);
+}
+
+//******************** ConsoleSink functions ************************
+
+ConsoleSink::ConsoleSink(int nRows, int nCols, bool shouldPause, bool ansi)
+ : m_screen(nRows, nCols), m_shouldPause(shouldPause), m_ansi(ansi),
+   m_useScreen(false), m_turns(0)
+{}
+
+// show a board under a line of text, either scrolling past as plain text
+// or in its place on the ANSI screen (slot 0 for the first player's board,
+// 1 for the second's)
+void ConsoleSink::show(int slot, const Board& b, bool shotsOnly, const string& text)
+{
+    if (!m_useScreen)
+    {
+        cout << text << '\n';
+        b.display(shotsOnly);
+    }
+    else
+    {
+        m_screen.drawBoard(slot, b, shotsOnly, (slot == 0 ? "Board 1" : "Board 2"));
+        m_screen.setStatus(text);
+        m_screen.present();
+    }
+}
+
+void ConsoleSink::report(const string& text)
+{
+    if (!m_useScreen)
+        cout << text << '\n';
+    else
+    {
+        m_screen.setStatus(text);
+        m_screen.present();
+    }
+}
+
+void ConsoleSink::onTurn(int player, const Player& attacker, const Player& defender,
+                         const Board& target)
+{
+    if (m_turns == 0)
+    {
+          // a human's prompts would scroll the fixed layout away, so only
+          // games between computer players use the ANSI screen
+        m_useScreen = m_ansi  &&  !attacker.isHuman()  &&  !defender.isHuman();
+    }
+    else if (m_shouldPause)
+    {
+        if (m_useScreen)
+            m_screen.finish();
+        waitForEnter();
+    }
+    m_turns++;
+    show(1 - player, target, attacker.isHuman(),
+         attacker.name() + "'s turn. Board for " + defender.name() + ":");
+}
+
+void ConsoleSink::onAttack(int player, const Player& attacker, Point p, bool validShot,
+                           bool shotHit, bool shipDestroyed, int shipId, const Board& target)
+{
+    ostringstream msg;
+    if (!validShot)
+    {
+        msg << attacker.name() << " wasted a shot at (" << p.r << "," << p.c << "). ";
+        report(msg.str());
+        return;
+    }
+    if (!shotHit)
+        msg << attacker.name() << " attacked (" << p.r << "," << p.c << ") and missed, resulting in: ";
+    else if (shipDestroyed)
+        msg << attacker.name() << " attacked (" << p.r << "," << p.c << ") and destroyed the " << attacker.game().shipName(shipId) <<  ", resulting in: ";
+    else
+        msg << attacker.name() << " attacked (" << p.r << "," << p.c << ") and hit something, resulting in: ";
+    show(1 - player, target, attacker.isHuman(), msg.str());
+}
+
+void ConsoleSink::onWin(int /* player */, const Player& winner, const Player& loser,
+                        const Board& winnerBoard, const Board& /* loserBoard */)
+{
+    report(winner.name() + " wins! ");
+    if (m_useScreen)
+        m_screen.finish();
+    if (loser.isHuman())
+    {
+        cout << "Here is where "<< winner.name() << "'s ships were: \n";
+        winnerBoard.display(false);
+    }
+}
+
+//******************** RecordingSink functions **********************
+
+// the game's setup is written with the first player's placement
+void RecordingSink::onPlacement(int player, const Player& p, const Board& b)
+{
+    const Game& g = p.game();
+    if (player == 0)
+    {
+        m_record.clear();
+        m_record.seed = g.seed();
+        m_record.rows = g.rows();
+        m_record.cols = g.cols();
+        for (int s = 0; s < g.nShips(); s++)
+        {
+            ShipRecord ship;
+            ship.length = g.shipLength(s);
+            ship.symbol = g.shipSymbol(s);
+            ship.name = g.shipName(s);
+            m_record.ships.push_back(ship);
+        }
+    }
+    m_record.names[player] = p.name();
+    for (int s = 0; s < g.nShips(); s++)
+    {
+        ShipPlacement placement;
+        if (b.shipPlacement(s, placement.topOrLeft, placement.dir))
+            m_record.placements[player].push_back(placement);
+    }
+}
+
+void RecordingSink::onAttack(int /* player */, const Player& /* attacker */, Point p,
+                             bool validShot, bool shotHit, bool shipDestroyed, int shipId,
+                             const Board& /* target */)
+{
+    ShotRecord shot;
+    shot.p = p;
+    shot.validShot = validShot;
+    shot.shotHit = shotHit;
+    shot.shipDestroyed = shipDestroyed;
+    shot.shipId = shipId;
+    m_record.shots.push_back(shot);
+}
+
+void RecordingSink::onWin(int player, const Player& /* winner */, const Player& /* loser */,
+                          const Board& /* winnerBoard */, const Board& /* loserBoard */)
+{
+    m_record.winner = player + 1;
+}
+
+//******************** StatsSink functions **************************
+
+void StatsSink::onPlacement(int /* player */, const Player& p, const Board& /* b */)
+{
+    m_totals[p.name()].games++;
+}
+
+void StatsSink::onAttack(int /* player */, const Player& attacker, Point /* p */,
+                         bool validShot, bool shotHit, bool /* shipDestroyed */,
+                         int /* shipId */, const Board& /* target */)
+{
+    Totals& t = m_totals[attacker.name()];
+    t.attacks++;
+    if (!validShot)
+        t.wasted++;
+    else if (shotHit)
+        t.hits++;
+}
+
+void StatsSink::onSink(int /* player */, const Player& attacker, int /* shipId */,
+                       const Board& /* target */)
+{
+    m_totals[attacker.name()].sinks++;
+}
+
+void StatsSink::onWin(int /* player */, const Player& winner, const Player& /* loser */,
+                      const Board& /* winnerBoard */, const Board& /* loserBoard */)
+{
+    m_totals[winner.name()].wins++;
+}
+
+void StatsSink::print(ostream& out) const
+{
+    out << left << setw(20) << "player" << right << setw(8) << "games" << setw(8) << "wins"
+        << setw(12) << "attacks/game" << setw(10) << "hit rate" << setw(8) << "wasted" << '\n';
+    for (map<string, Totals>::const_iterator p = m_totals.begin(); p != m_totals.end(); p++)
+    {
+        const Totals& t = p->second;
+        out << left << setw(20) << p->first << right << setw(8) << t.games
+            << setw(8) << t.wins << fixed << setprecision(1)
+            << setw(12) << (t.games == 0 ? 0.0 : double(t.attacks) / t.games)
+            << setw(9) << (t.attacks == 0 ? 0.0 : 100.0 * t.hits / t.attacks) << '%'
+            << setw(8) << t.wasted << '\n';
+        out.unsetf(ios::fixed);
+    }
+}
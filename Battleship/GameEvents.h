@@ -0,0 +1,154 @@
+#ifndef GAMEEVENTS_INCLUDED
+#define GAMEEVENTS_INCLUDED
+
+#include "globals.h"
+#include "GameRecord.h"
+#include "AnsiScreen.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <iosfwd>
+
+class Board;
+class Player;
+
+// Receives what happens in a game as Game::play runs it.  Players are
+// numbered 0 (the one who moves first) and 1; the Board passed with an
+// event is the one being attacked (or, for onPlacement, the one just
+// filled).  Every function does nothing unless overridden.
+class GameEventSink
+{
+  public:
+    virtual ~GameEventSink() {}
+      // player has placed its ships on b
+    virtual void onPlacement(int /* player */, const Player& /* p */,
+                             const Board& /* b */) {}
+      // attacker is about to choose an attack on target
+    virtual void onTurn(int /* player */, const Player& /* attacker */,
+                        const Player& /* defender */, const Board& /* target */) {}
+      // attacker attacked p; shotHit and shipDestroyed are false for a
+      // wasted shot, and shipId is -1 unless a ship was destroyed
+    virtual void onAttack(int /* player */, const Player& /* attacker */, Point /* p */,
+                          bool /* validShot */, bool /* shotHit */,
+                          bool /* shipDestroyed */, int /* shipId */,
+                          const Board& /* target */) {}
+      // the attack just reported destroyed ship shipId
+    virtual void onSink(int /* player */, const Player& /* attacker */, int /* shipId */,
+                        const Board& /* target */) {}
+      // winner has destroyed every ship on loserBoard
+    virtual void onWin(int /* player */, const Player& /* winner */,
+                       const Player& /* loser */, const Board& /* winnerBoard */,
+                       const Board& /* loserBoard */) {}
+};
+
+// Ignores everything.  It isn't derived from GameEventSink: the game loop
+// is a template on the kind of sink, so with this one every event call is
+// an empty inline function and compiles to nothing.
+class NullSink
+{
+  public:
+    void onPlacement(int, const Player&, const Board&) {}
+    void onTurn(int, const Player&, const Player&, const Board&) {}
+    void onAttack(int, const Player&, Point, bool, bool, bool, int, const Board&) {}
+    void onSink(int, const Player&, int, const Board&) {}
+    void onWin(int, const Player&, const Player&, const Board&, const Board&) {}
+};
+
+// Passes every event on to each of a list of sinks, in order
+class SinkList : public GameEventSink
+{
+  public:
+    void add(GameEventSink* sink) { m_sinks.push_back(sink); }
+    bool empty() const { return m_sinks.empty(); }
+
+    virtual void onPlacement(int player, const Player& p, const Board& b);
+    virtual void onTurn(int player, const Player& attacker, const Player& defender,
+                        const Board& target);
+    virtual void onAttack(int player, const Player& attacker, Point p, bool validShot,
+                          bool shotHit, bool shipDestroyed, int shipId,
+                          const Board& target);
+    virtual void onSink(int player, const Player& attacker, int shipId,
+                        const Board& target);
+    virtual void onWin(int player, const Player& winner, const Player& loser,
+                       const Board& winnerBoard, const Board& loserBoard);
+
+  private:
+    std::vector<GameEventSink*> m_sinks;
+};
+
+// Reports a game on the console, pausing for Enter between turns if asked
+// to.  With ansi set, a game between computer players is shown on an
+// AnsiScreen instead of as scrolling text.
+class ConsoleSink : public GameEventSink
+{
+  public:
+    ConsoleSink(int nRows, int nCols, bool shouldPause, bool ansi);
+
+    virtual void onTurn(int player, const Player& attacker, const Player& defender,
+                        const Board& target);
+    virtual void onAttack(int player, const Player& attacker, Point p, bool validShot,
+                          bool shotHit, bool shipDestroyed, int shipId,
+                          const Board& target);
+    virtual void onWin(int player, const Player& winner, const Player& loser,
+                       const Board& winnerBoard, const Board& loserBoard);
+
+  private:
+    void show(int slot, const Board& b, bool shotsOnly, const std::string& text);
+    void report(const std::string& text);
+
+    AnsiScreen m_screen;
+    bool m_shouldPause;
+    bool m_ansi;
+    bool m_useScreen;
+    int m_turns;
+};
+
+// Writes a game into a GameRecord
+class RecordingSink : public GameEventSink
+{
+  public:
+    RecordingSink(GameRecord& record) : m_record(record) {}
+
+    virtual void onPlacement(int player, const Player& p, const Board& b);
+    virtual void onAttack(int player, const Player& attacker, Point p, bool validShot,
+                          bool shotHit, bool shipDestroyed, int shipId,
+                          const Board& target);
+    virtual void onWin(int player, const Player& winner, const Player& loser,
+                       const Board& winnerBoard, const Board& loserBoard);
+
+  private:
+    GameRecord& m_record;
+};
+
+// Totals over any number of games, for each player by name
+class StatsSink : public GameEventSink
+{
+  public:
+    struct Totals
+    {
+        Totals() : games(0), wins(0), attacks(0), wasted(0), hits(0), sinks(0) {}
+        long games;
+        long wins;
+        long attacks;
+        long wasted;
+        long hits;
+        long sinks;
+    };
+
+    virtual void onPlacement(int player, const Player& p, const Board& b);
+    virtual void onAttack(int player, const Player& attacker, Point p, bool validShot,
+                          bool shotHit, bool shipDestroyed, int shipId,
+                          const Board& target);
+    virtual void onSink(int player, const Player& attacker, int shipId,
+                        const Board& target);
+    virtual void onWin(int player, const Player& winner, const Player& loser,
+                       const Board& winnerBoard, const Board& loserBoard);
+
+    const std::map<std::string, Totals>& totals() const { return m_totals; }
+    void print(std::ostream& out) const;
+
+  private:
+    std::map<std::string, Totals> m_totals;
+};
+
+#endif // GAMEEVENTS_INCLUDED
@@ -0,0 +1,520 @@
+#include "GameRecord.h"
+#include "globals.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+using namespace std;
+
+static const char FILE_MAGIC[4] = { 'B', 'S', 'G', 'R' };
+static const uint32_t FILE_VERSION = 1;
+static const int FILE_HEADER_SIZE = 8;
+static const char CHUNK_MAGIC[4] = { 'C', 'H', 'N', 'K' };
+
+// outcome of a shot, kept in the low two bits of its encoding
+enum { SHOT_INVALID, SHOT_MISS, SHOT_HIT, SHOT_SUNK };
+
+// what leads each record: whether the board and ships follow, and if not,
+// how the player names compare with the previous record's.  A new setup
+// always carries the names with it.  A tournament alternates which player
+// moves first, so names that just swapped sides get a code of their own.
+enum { SETUP_SAME, SETUP_NEW, SETUP_NAMES, SETUP_SWAPPED };
+
+static void putFixed32(string& out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        out += char(v >> (8*i));
+}
+
+static uint32_t getFixed32(const char* p)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= uint32_t((unsigned char)p[i]) << (8*i);
+    return v;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+bool sameSetup(const GameRecord& a, const GameRecord& b)
+{
+    if (a.rows != b.rows  ||  a.cols != b.cols  ||
+        a.ships.size() != b.ships.size())
+        return false;
+    for (size_t s = 0; s < a.ships.size(); s++)
+    {
+        if (a.ships[s].length != b.ships[s].length  ||
+            a.ships[s].symbol != b.ships[s].symbol  ||
+            a.ships[s].name != b.ships[s].name)
+            return false;
+    }
+    return true;
+}
+
+void GameRecord::clear()
+{
+    seed = 0;
+    rows = cols = 0;
+    ships.clear();
+    for (int i = 0; i < 2; i++)
+    {
+        names[i].clear();
+        placements[i].clear();
+    }
+    shots.clear();
+    winner = 0;
+}
+
+int recordFileHeaderSize(const char* begin, const char* end)
+{
+    if (end - begin < FILE_HEADER_SIZE  ||  memcmp(begin, FILE_MAGIC, 4) != 0  ||
+        getFixed32(begin + 4) != FILE_VERSION)
+        return 0;
+    return FILE_HEADER_SIZE;
+}
+
+bool readChunkHeader(const char* p, const char* end, ChunkHeader& h)
+{
+    if (end - p < ChunkHeader::SIZE  ||  memcmp(p, CHUNK_MAGIC, 4) != 0)
+        return false;
+    h.nBytes = getFixed32(p + 4);
+    h.nRecords = getFixed32(p + 8);
+    h.checksum = getFixed32(p + 12);
+    return true;
+}
+
+uint32_t recordChecksum(const char* begin, const char* end)
+{
+    uint32_t h = 2166136261u;
+    for (const char* p = begin; p != end; p++)
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    return h;
+}
+
+//******************** GameRecordEncoder ******************************
+
+void GameRecordEncoder::clear()
+{
+    m_bytes.clear();
+    m_nRecords = 0;
+    m_setup.clear();
+}
+
+void GameRecordEncoder::putVarint(uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        m_bytes += char(v | 0x80);
+        v >>= 7;
+    }
+    m_bytes += char(v);
+}
+
+void GameRecordEncoder::putString(const string& s)
+{
+    putVarint(s.size());
+    m_bytes += s;
+}
+
+void GameRecordEncoder::add(const GameRecord& r)
+{
+    int kind;
+    if (m_nRecords == 0  ||  !sameSetup(r, m_setup))
+        kind = SETUP_NEW;
+    else if (r.names[0] == m_setup.names[0]  &&  r.names[1] == m_setup.names[1])
+        kind = SETUP_SAME;
+    else if (r.names[0] == m_setup.names[1]  &&  r.names[1] == m_setup.names[0])
+        kind = SETUP_SWAPPED;
+    else
+        kind = SETUP_NAMES;
+    putVarint(kind);
+    if (kind == SETUP_NEW)
+    {
+        putVarint(r.rows);
+        putVarint(r.cols);
+        putVarint(r.ships.size());
+        for (size_t s = 0; s < r.ships.size(); s++)
+        {
+            putVarint(r.ships[s].length);
+            m_bytes += r.ships[s].symbol;
+            putString(r.ships[s].name);
+        }
+        m_setup.rows = r.rows;
+        m_setup.cols = r.cols;
+        m_setup.ships = r.ships;
+    }
+    if (kind == SETUP_NEW  ||  kind == SETUP_NAMES)
+    {
+        putString(r.names[0]);
+        putString(r.names[1]);
+    }
+    if (kind != SETUP_SAME)
+    {
+        m_setup.names[0] = r.names[0];
+        m_setup.names[1] = r.names[1];
+    }
+
+    for (int i = 0; i < 8; i++)
+        m_bytes += char(r.seed >> (8*i));
+    putVarint(r.winner);
+
+    for (int side = 0; side < 2; side++)
+    {
+        const vector<ShipPlacement>& ps = r.placements[side];
+        putVarint(ps.size());
+        for (size_t s = 0; s < ps.size(); s++)
+        {
+            uint64_t cell = uint64_t(ps[s].topOrLeft.r) * r.cols + ps[s].topOrLeft.c;
+            putVarint(cell * 2 + (ps[s].dir == VERTICAL));
+        }
+    }
+
+      // a valid shot is its distance from the same player's previous
+      // valid shot, with the outcome in the low bits; a wasted shot may be
+      // off the board, so its row and column follow separately
+    putVarint(r.shots.size());
+    int64_t prev[2] = { 0, 0 };
+    for (size_t k = 0; k < r.shots.size(); k++)
+    {
+        const ShotRecord& shot = r.shots[k];
+        int side = k % 2;
+        if (!shot.validShot)
+        {
+            putVarint(SHOT_INVALID);
+            putVarint(zigzag(shot.p.r));
+            putVarint(zigzag(shot.p.c));
+            continue;
+        }
+        int64_t cell = int64_t(shot.p.r) * r.cols + shot.p.c;
+        int outcome = (!shot.shotHit ? SHOT_MISS :
+                       shot.shipDestroyed ? SHOT_SUNK : SHOT_HIT);
+        putVarint(zigzag(cell - prev[side]) << 2 | outcome);
+        if (outcome == SHOT_SUNK)
+            putVarint(shot.shipId);
+        prev[side] = cell;
+    }
+    m_nRecords++;
+}
+
+//******************** GameRecordDecoder ******************************
+
+GameRecordDecoder::GameRecordDecoder(const char* begin, const char* end)
+ : m_p(begin), m_end(end)
+{
+}
+
+bool GameRecordDecoder::getVarint(uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64  &&  m_p != m_end; shift += 7)
+    {
+        unsigned char b = *m_p++;
+        v |= uint64_t(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool GameRecordDecoder::getString(string& s)
+{
+    uint64_t n;
+    if (!getVarint(n)  ||  n > uint64_t(m_end - m_p))
+        return false;
+    s.assign(m_p, n);
+    m_p += n;
+    return true;
+}
+
+// every count is checked against the bytes left, since each item takes at
+// least one, so damaged data can't make us allocate wildly
+bool GameRecordDecoder::next(GameRecord& r)
+{
+    uint64_t kind, v;
+    if (m_p == m_end  ||  !getVarint(kind)  ||  kind > SETUP_SWAPPED)
+        return false;
+    if (kind == SETUP_NEW)
+    {
+        uint64_t rows, cols, nShips;
+        if (!getVarint(rows)  ||  !getVarint(cols)  ||  !getVarint(nShips)  ||
+            rows < 1  ||  cols < 1  ||  rows > uint64_t(MAXCELLS / cols)  ||
+            nShips > uint64_t(m_end - m_p))
+            return false;
+        m_setup.clear();
+        m_setup.rows = (int)rows;
+        m_setup.cols = (int)cols;
+        m_setup.ships.resize(nShips);
+        for (size_t s = 0; s < nShips; s++)
+        {
+            if (!getVarint(v)  ||  m_p == m_end)
+                return false;
+            m_setup.ships[s].length = (int)v;
+            m_setup.ships[s].symbol = *m_p++;
+            if (!getString(m_setup.ships[s].name))
+                return false;
+        }
+    }
+    else if (m_setup.rows == 0)
+        return false;
+    if (kind == SETUP_NEW  ||  kind == SETUP_NAMES)
+    {
+        if (!getString(m_setup.names[0])  ||  !getString(m_setup.names[1]))
+            return false;
+    }
+    else if (kind == SETUP_SWAPPED)
+        m_setup.names[0].swap(m_setup.names[1]);
+
+    r.rows = m_setup.rows;
+    r.cols = m_setup.cols;
+    r.ships = m_setup.ships;
+    r.names[0] = m_setup.names[0];
+    r.names[1] = m_setup.names[1];
+
+    if (m_end - m_p < 8)
+        return false;
+    r.seed = 0;
+    for (int i = 0; i < 8; i++)
+        r.seed |= uint64_t((unsigned char)*m_p++) << (8*i);
+    if (!getVarint(v))
+        return false;
+    r.winner = (int)v;
+
+    uint64_t nCells = uint64_t(r.rows) * r.cols;
+    for (int side = 0; side < 2; side++)
+    {
+        uint64_t n;
+        if (!getVarint(n)  ||  n > r.ships.size())
+            return false;
+        r.placements[side].resize(n);
+        for (size_t s = 0; s < n; s++)
+        {
+            if (!getVarint(v)  ||  v / 2 >= nCells)
+                return false;
+            r.placements[side][s].topOrLeft = Point(int(v / 2 / r.cols), int(v / 2 % r.cols));
+            r.placements[side][s].dir = (v & 1 ? VERTICAL : HORIZONTAL);
+        }
+    }
+
+    uint64_t nShots;
+    if (!getVarint(nShots)  ||  nShots > uint64_t(m_end - m_p))
+        return false;
+    r.shots.resize(nShots);
+    int64_t prev[2] = { 0, 0 };
+    for (size_t k = 0; k < nShots; k++)
+    {
+        ShotRecord& shot = r.shots[k];
+        int side = k % 2;
+        if (!getVarint(v))
+            return false;
+        int outcome = int(v & 3);
+        shot.shipId = -1;
+        if (outcome == SHOT_INVALID)
+        {
+            uint64_t row, col;
+            if (!getVarint(row)  ||  !getVarint(col))
+                return false;
+            shot.p = Point(int(unzigzag(row)), int(unzigzag(col)));
+            shot.validShot = shot.shotHit = shot.shipDestroyed = false;
+            continue;
+        }
+        int64_t cell = prev[side] + unzigzag(v >> 2);
+        if (cell < 0  ||  uint64_t(cell) >= nCells)
+            return false;
+        prev[side] = cell;
+        shot.p = Point(int(cell / r.cols), int(cell % r.cols));
+        shot.validShot = true;
+        shot.shotHit = (outcome != SHOT_MISS);
+        shot.shipDestroyed = (outcome == SHOT_SUNK);
+        if (shot.shipDestroyed)
+        {
+            if (!getVarint(v)  ||  v >= r.ships.size())
+                return false;
+            shot.shipId = (int)v;
+        }
+    }
+    return true;
+}
+
+//******************** GameRecordWriter *******************************
+
+// Return the length of the part of a record file that holds complete
+// chunks; in must be just past the file header, and size is the length of
+// the whole file.  A chunk is complete if its header is intact, its
+// records are all there and they match its checksum.
+static uint64_t completeLength(ifstream& in, uint64_t size)
+{
+    uint64_t length = FILE_HEADER_SIZE;
+    string body;
+    char header[ChunkHeader::SIZE];
+    ChunkHeader h;
+    while (in.read(header, ChunkHeader::SIZE)  &&
+           readChunkHeader(header, header + ChunkHeader::SIZE, h)  &&
+           h.nBytes <= size - length - ChunkHeader::SIZE)
+    {
+        body.resize(h.nBytes);
+        if (!in.read(&body[0], h.nBytes)  ||
+            recordChecksum(body.data(), body.data() + h.nBytes) != h.checksum)
+            break;
+        length += ChunkHeader::SIZE + h.nBytes;
+    }
+    return length;
+}
+
+GameRecordWriter::GameRecordWriter(const string& path, int chunkBytes)
+ : m_chunkBytes(chunkBytes)
+{
+      // a new file gets a header; an existing one must already have one,
+      // and loses any incomplete chunk a crash left at its end, so the
+      // chunks written now follow on from the last complete one
+    ifstream in(path, ios::binary | ios::ate);
+    char header[FILE_HEADER_SIZE];
+    uint64_t size = (in ? uint64_t(in.tellg()) : 0);
+    bool exists = (size > 0);
+    if (exists)
+    {
+        in.seekg(0);
+        in.read(header, FILE_HEADER_SIZE);
+        if (!in  ||  recordFileHeaderSize(header, header + FILE_HEADER_SIZE) == 0)
+            return;
+        uint64_t length = completeLength(in, size);
+        in.close();
+        error_code ec;
+        if (length < size)
+            filesystem::resize_file(path, length, ec);
+        if (ec)
+            return;
+    }
+    in.close();
+
+    m_out.open(path, ios::binary | ios::app);
+    if (m_out  &&  !exists)
+    {
+        string h(FILE_MAGIC, 4);
+        putFixed32(h, FILE_VERSION);
+        m_out.write(h.data(), h.size());
+    }
+}
+
+GameRecordWriter::~GameRecordWriter()
+{
+    flush();
+}
+
+bool GameRecordWriter::isOpen() const
+{
+    return m_out.is_open()  &&  m_out.good();
+}
+
+void GameRecordWriter::write(const GameRecord& r)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_chunk.add(r);
+    if ((int)m_chunk.bytes().size() >= m_chunkBytes)
+        writeChunk();
+}
+
+void GameRecordWriter::flush()
+{
+    lock_guard<mutex> lock(m_mutex);
+    writeChunk();
+    m_out.flush();
+}
+
+// the header and records go out in one write, so the file never holds a
+// header without its records unless the write itself fails
+void GameRecordWriter::writeChunk()
+{
+    if (m_chunk.nRecords() == 0  ||  !m_out.is_open())
+        return;
+    const string& body = m_chunk.bytes();
+    string chunk(CHUNK_MAGIC, 4);
+    putFixed32(chunk, (uint32_t)body.size());
+    putFixed32(chunk, (uint32_t)m_chunk.nRecords());
+    putFixed32(chunk, recordChecksum(body.data(), body.data() + body.size()));
+    chunk += body;
+    m_out.write(chunk.data(), chunk.size());
+    m_chunk.clear();
+}
+
+//******************** GameRecordReader *******************************
+
+GameRecordReader::GameRecordReader(const string& path)
+ : m_in(path, ios::binary | ios::ate), m_open(false), m_damaged(false),
+   m_decoder(nullptr, nullptr), m_left(0), m_size(0)
+{
+    if (!m_in)
+        return;
+    m_size = uint64_t(m_in.tellg());
+    m_in.seekg(0);
+    char header[FILE_HEADER_SIZE];
+    if (m_in.read(header, FILE_HEADER_SIZE))
+        m_open = recordFileHeaderSize(header, header + FILE_HEADER_SIZE) != 0;
+}
+
+bool GameRecordReader::isOpen() const
+{
+    return m_open;
+}
+
+bool GameRecordReader::readChunk()
+{
+    char header[ChunkHeader::SIZE];
+    if (!m_in.read(header, ChunkHeader::SIZE))
+    {
+        m_damaged = (m_in.gcount() != 0);
+        return false;
+    }
+    ChunkHeader h;
+    if (!readChunkHeader(header, header + ChunkHeader::SIZE, h))
+    {
+        m_damaged = true;
+        return false;
+    }
+      // a damaged length mustn't make us allocate more than the file holds
+    uint64_t at = uint64_t(m_in.tellg());
+    if (h.nBytes > m_size - at)
+    {
+        m_damaged = true;
+        return false;
+    }
+    m_chunk.resize(h.nBytes);
+    if (!m_in.read(&m_chunk[0], h.nBytes)  ||
+        recordChecksum(m_chunk.data(), m_chunk.data() + h.nBytes) != h.checksum)
+    {
+        m_damaged = true;
+        return false;
+    }
+    m_decoder = GameRecordDecoder(m_chunk.data(), m_chunk.data() + h.nBytes);
+    m_left = h.nRecords;
+    return true;
+}
+
+bool GameRecordReader::next(GameRecord& r)
+{
+    if (!m_open  ||  m_damaged)
+        return false;
+    while (m_left == 0)
+    {
+        if (!readChunk())
+            return false;
+    }
+    if (!m_decoder.next(r))
+    {
+        m_damaged = true;
+        return false;
+    }
+    m_left--;
+    return true;
+}
@@ -0,0 +1,169 @@
+#ifndef GAMERECORD_INCLUDED
+#define GAMERECORD_INCLUDED
+
+#include "globals.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+
+// One attack, with the outcome Board::attack reported for it
+struct ShotRecord
+{
+    Point p;
+    bool validShot;
+    bool shotHit;
+    bool shipDestroyed;
+    int shipId;             // the ship destroyed by this shot, or -1
+};
+
+struct ShipRecord
+{
+    int length;
+    char symbol;
+    std::string name;
+};
+
+struct ShipPlacement
+{
+    Point topOrLeft;
+    Direction dir;
+};
+
+// Everything needed to replay a game: its seed and setup, where each
+// player put their ships, and every attack in order.  Attacks alternate
+// between the players, player 1 first.
+struct GameRecord
+{
+    GameRecord() : seed(0), rows(0), cols(0), winner(0) {}
+    void clear();
+
+    uint64_t seed;
+    int rows;
+    int cols;
+    std::vector<ShipRecord> ships;
+    std::string names[2];
+    std::vector<ShipPlacement> placements[2];  // each player's own ships, by shipId
+    std::vector<ShotRecord> shots;
+    int winner;             // 1 or 2
+};
+
+// A record file is a file header followed by chunks, each of which is a
+// header and then the encoded records.  Chunks are only ever appended,
+// so a file can be added to by later runs.  A chunk left incomplete by a
+// crash is where readers stop, and is cut off when a GameRecordWriter
+// next opens the file, so the chunks it appends can be read.
+struct ChunkHeader
+{
+    static const int SIZE = 16;
+
+    uint32_t nBytes;        // encoded records following the header
+    uint32_t nRecords;
+    uint32_t checksum;      // FNV-1a of the encoded records
+};
+
+  // Check the file header at the start of a record file and return its
+  // size, or 0 if it isn't there
+int recordFileHeaderSize(const char* begin, const char* end);
+
+  // Parse the chunk header at p; return false if it is missing or damaged
+bool readChunkHeader(const char* p, const char* end, ChunkHeader& h);
+
+uint32_t recordChecksum(const char* begin, const char* end);
+
+  // whether two records are of the same board size and ships, whoever
+  // played them
+bool sameSetup(const GameRecord& a, const GameRecord& b);
+
+// Encodes records into one chunk's worth of bytes.  Cells are stored as
+// varints, each shot relative to the same player's previous shot, so a
+// typical 10 x 10 game takes two or three bytes per attack.  The board
+// size and ships are written only when they differ from the previous
+// record in the chunk, and the player names only when they are neither
+// the same as the previous record's nor the same two swapped.
+class GameRecordEncoder
+{
+  public:
+    GameRecordEncoder() { clear(); }
+    void clear();
+    void add(const GameRecord& r);
+    int nRecords() const { return m_nRecords; }
+    const std::string& bytes() const { return m_bytes; }
+
+  private:
+    void putVarint(uint64_t v);
+    void putString(const std::string& s);
+
+    std::string m_bytes;
+    int m_nRecords;
+    GameRecord m_setup;     // setup of the last record added
+};
+
+// Decodes the records of one chunk
+class GameRecordDecoder
+{
+  public:
+    GameRecordDecoder(const char* begin, const char* end);
+      // decode the next record into r; return false at the end of the
+      // chunk or if the bytes don't make sense
+    bool next(GameRecord& r);
+
+  private:
+    bool getVarint(uint64_t& v);
+    bool getString(std::string& s);
+
+    const char* m_p;
+    const char* m_end;
+    GameRecord m_setup;
+};
+
+// Appends records to a record file, a chunk at a time.  write() may be
+// called from several threads at once.
+class GameRecordWriter
+{
+  public:
+    GameRecordWriter(const std::string& path, int chunkBytes = 1 << 16);
+    ~GameRecordWriter();
+    bool isOpen() const;
+    void write(const GameRecord& r);
+      // write out the chunk being built, even if it isn't full
+    void flush();
+      // We prevent a GameRecordWriter object from being copied or assigned
+    GameRecordWriter(const GameRecordWriter&) = delete;
+    GameRecordWriter& operator=(const GameRecordWriter&) = delete;
+
+  private:
+    void writeChunk();
+
+    std::mutex m_mutex;
+    std::ofstream m_out;
+    int m_chunkBytes;
+    GameRecordEncoder m_chunk;
+};
+
+// Reads the records of a record file in order, holding only one chunk in
+// memory at a time
+class GameRecordReader
+{
+  public:
+    GameRecordReader(const std::string& path);
+    bool isOpen() const;
+      // read the next record into r; return false at the end of the file
+      // or at a damaged chunk
+    bool next(GameRecord& r);
+    bool damaged() const { return m_damaged; }
+
+  private:
+    bool readChunk();
+
+    std::ifstream m_in;
+    bool m_open;
+    bool m_damaged;
+    std::string m_chunk;
+    GameRecordDecoder m_decoder;
+    uint32_t m_left;        // records of the current chunk not yet read
+    uint64_t m_size;        // length of the file
+};
+
+#endif // GAMERECORD_INCLUDED
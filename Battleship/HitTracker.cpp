@@ -0,0 +1,223 @@
+#include "HitTracker.h"
+#include "Game.h"
+#include <algorithm>
+
+using namespace std;
+
+HitTracker::HitTracker(const Game& g)
+ : m_game(g), m_rows(g.rows()), m_cols(g.cols()), m_maxLength(0)
+{
+    for (int k = 0; k < g.nShips(); k++)
+        m_maxLength = max(m_maxLength, g.shipLength(k));
+    m_afloat.resize(m_maxLength + 1);
+    m_open.reserve(g.rows() * g.cols());
+    m_pending.reserve(g.nShips());
+    m_run.resize(2 * m_maxLength + 1);
+    reset();
+}
+
+void HitTracker::reset()
+{
+    m_blocked.clear();
+    m_hits.clear();
+    m_sinkCells.clear();
+    m_open.clear();
+    m_pending.clear();
+    fill(m_afloat.begin(), m_afloat.end(), 0);
+    for (int k = 0; k < m_game.nShips(); k++)
+        m_afloat[m_game.shipLength(k)]++;
+}
+
+void HitTracker::recordMiss(Point p)
+{
+    m_blocked.set(cellOf(p));
+}
+
+void HitTracker::recordHit(Point p)
+{
+    m_hits.set(cellOf(p));
+    m_open.push_back(cellOf(p));
+}
+
+void HitTracker::recordSink(Point p, int shipId)
+{
+    int cell = cellOf(p);
+    int len = m_game.shipLength(shipId);
+    m_hits.set(cell);
+    m_sinkCells.set(cell);
+    m_blocked.set(cell);
+    if (m_afloat[len] > 0)
+        m_afloat[len]--;
+    Sink s;
+    s.cell = cell;
+    s.len = len;
+    m_pending.push_back(s);
+    propagate();
+}
+
+// whether a ship afloat could lie on p: it's on the board, and isn't a miss
+// or part of a sunk ship
+bool HitTracker::canHold(Point p) const
+{
+    return p.r >= 0  &&  p.r < m_rows  &&  p.c >= 0  &&  p.c < m_cols  &&
+           !m_blocked.test(cellOf(p));
+}
+
+// Count the lines of s.len hits not yet located that run through the cell
+// that sank s and through no other pending sink's cell; start and step are
+// set to the first cell of the last one found and the distance between its
+// cells
+int HitTracker::lines(const Sink& s, int& start, int& step) const
+{
+    Point p(s.cell / m_cols, s.cell % m_cols);
+    int n = 0;
+    for (int d = 0; d < 2; d++)
+    {
+        for (int k = 0; k < s.len; k++)
+        {
+            Point first = (d == 0 ? Point(p.r, p.c-k) : Point(p.r-k, p.c));
+            Point last = (d == 0 ? Point(first.r, first.c+s.len-1) : Point(first.r+s.len-1, first.c));
+            if (!m_game.isValid(first)  ||  !m_game.isValid(last))
+                continue;
+            int st = (d == 0 ? 1 : m_cols);
+            bool all = true;
+            for (int i = 0, cell = cellOf(first); i < s.len  &&  all; i++, cell += st)
+                all = m_hits.test(cell)  &&  (cell == s.cell  ||  !m_sinkCells.test(cell));
+            if (all)
+            {
+                n++;
+                start = cellOf(first);
+                step = st;
+            }
+        }
+          // a ship of length 1 is the same line either way
+        if (s.len == 1)
+            break;
+    }
+    return n;
+}
+
+// Locate every pending sink that has only one line left.  Locating a ship
+// takes its hits away from the other sinks' lines, so this goes on until no
+// sink is settled.
+void HitTracker::propagate()
+{
+    for (size_t i = 0; i < m_pending.size(); )
+    {
+        Sink s = m_pending[i];
+        int start = s.cell;
+        int step = 1;
+        int n = lines(s, start, step);
+        if (n > 1)
+        {
+            i++;
+            continue;
+        }
+        m_pending[i] = m_pending.back();
+        m_pending.pop_back();
+        m_sinkCells.reset(s.cell);
+        if (n == 1)
+        {
+            for (int k = 0; k < s.len; k++)
+                retire(start + k*step);
+        }
+        else
+            retire(s.cell);     // the hits don't line up (shouldn't happen)
+        i = 0;
+    }
+}
+
+// cell is part of a located sunk ship
+void HitTracker::retire(int cell)
+{
+    m_hits.reset(cell);
+    m_blocked.set(cell);
+    GameVector<int>::iterator it = find(m_open.begin(), m_open.end(), cell);
+    if (it != m_open.end())
+    {
+        *it = m_open.back();
+        m_open.pop_back();
+    }
+}
+
+// Count the placements of ships afloat through hit along one line (across
+// or down) that cover the cell before hit and the cell after it, weighting
+// each by the number of hits not yet located it covers, into before and
+// after
+void HitTracker::score(Point hit, bool across, int& before, int& after) const
+{
+      // the cells a ship could lie on run from lo to hi steps from hit;
+      // m_run[k - lo + 1] is the number of hits among the first k - lo + 1
+    int lo = 0;
+    int hi = 0;
+    while (lo > 1 - m_maxLength  &&
+           canHold(across ? Point(hit.r, hit.c+lo-1) : Point(hit.r+lo-1, hit.c)))
+        lo--;
+    while (hi < m_maxLength - 1  &&
+           canHold(across ? Point(hit.r, hit.c+hi+1) : Point(hit.r+hi+1, hit.c)))
+        hi++;
+    m_run[0] = 0;
+    for (int k = lo; k <= hi; k++)
+    {
+        Point p = (across ? Point(hit.r, hit.c+k) : Point(hit.r+k, hit.c));
+        m_run[k - lo + 1] = m_run[k - lo] + m_hits.test(cellOf(p));
+    }
+
+    before = after = 0;
+    for (int len = 2; len <= m_maxLength  &&  len <= hi - lo + 1; len++)
+    {
+        if (m_afloat[len] == 0)
+            continue;
+          // a placement starting s steps from hit covers the cell before
+          // hit if it starts at -1 or earlier, the one after if it ends at
+          // 1 or later
+        for (int s = max(lo, 1 - len); s <= 0  &&  s + len - 1 <= hi; s++)
+        {
+            int hits = m_afloat[len] * (m_run[s + len - lo] - m_run[s - lo]);
+            before += (s <= -1 ? hits : 0);
+            after += (s + len - 1 >= 1 ? hits : 0);
+        }
+    }
+}
+
+bool HitTracker::target(Point& p)
+{
+    int best = 0;
+    for (size_t i = 0; i < m_open.size(); )
+    {
+        Point hit(m_open[i] / m_cols, m_open[i] % m_cols);
+        bool reachable = false;
+          // left and right, then up and down
+        for (int d = 0; d < 2; d++)
+        {
+            bool across = (d == 0);
+            int s[2];
+            score(hit, across, s[0], s[1]);
+            for (int k = 0; k < 2; k++)
+            {
+                int step = 2*k - 1;
+                Point next = (across ? Point(hit.r, hit.c+step) : Point(hit.r+step, hit.c));
+                if (s[k] == 0  ||  m_hits.test(cellOf(next))  ||
+                    m_blocked.test(cellOf(next)))
+                    continue;
+                reachable = true;
+                if (s[k] > best)
+                {
+                    best = s[k];
+                    p = next;
+                }
+            }
+        }
+
+          // scores only ever go down, so a hit no ship afloat can reach
+          // through an unshot cell never will; stop looking at it
+        if (reachable)
+            i++;
+        else
+        {
+            m_open[i] = m_open.back();
+            m_open.pop_back();
+        }
+    }
+    return best > 0;
+}
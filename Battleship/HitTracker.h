@@ -0,0 +1,87 @@
+#ifndef HITTRACKER_INCLUDED
+#define HITTRACKER_INCLUDED
+
+#include "globals.h"
+#include "Bitboard.h"
+#include "Arena.h"
+
+class Game;
+
+// Keeps track of what a player's hits say about the opponent's ships, for
+// the target phase: which hits might still belong to a ship afloat, and
+// which ships are left to cover them.  It is told about each of the
+// player's attacks as it is made and does a small amount of work near the
+// attacked cell; nothing ever looks at the whole board.
+//
+// When a ship is sunk, the tracker looks for a line of the ship's length
+// made of hits not yet accounted for that runs through the cell that sank
+// it.  If there is only one, those cells are the ship.  If ships lie side
+// by side there may be several; the sink is then kept pending, and is
+// settled when other sinks use up all but one of its possible lines.  A
+// hit counts as open (still worth shooting around) unless it is known to
+// be part of a sunk ship.
+class HitTracker
+{
+  public:
+    HitTracker(const Game& g);
+
+      // every ship afloat, nothing attacked
+    void reset();
+
+      // the result of an attack on p, which must be on the board and not
+      // have been attacked before; shipId is the ship the attack sank
+    void recordMiss(Point p);
+    void recordHit(Point p);
+    void recordSink(Point p, int shipId);
+
+      // whether some hit may belong to a ship still afloat
+    bool hasOpenHits() const { return !m_open.empty(); }
+
+      // the misses, and the cells known to be part of a sunk ship; the
+      // cell whose attack sank a ship is one even before the ship is
+      // located
+    const Bitboard& blocked() const { return m_blocked; }
+
+      // the hits not in blocked(), which a ship afloat may cover
+    Bitboard unexplained() const
+    {
+        Bitboard b = m_hits;
+        return b.subtract(m_blocked);
+    }
+
+      // set p to the cell next to an open hit that the most ways of
+      // placing the ships afloat through that hit cover, counting a way
+      // once for each hit it explains, among the cells not yet attacked
+      // (which are those neither hit nor blocked); return false if no ship
+      // afloat can cover any open hit.  Open hits that no ship afloat can
+      // reach any more are dropped along the way.
+    bool target(Point& p);
+
+  private:
+    struct Sink
+    {
+        int cell;       // the cell whose attack sank the ship
+        int len;
+    };
+
+    int cellOf(Point p) const { return p.r * m_cols + p.c; }
+    bool canHold(Point p) const;
+    int lines(const Sink& s, int& start, int& step) const;
+    void propagate();
+    void retire(int cell);
+    void score(Point hit, bool across, int& before, int& after) const;
+
+    const Game& m_game;
+    int m_rows;
+    int m_cols;
+    int m_maxLength;
+    Bitboard m_blocked;             // misses and the cells known to be in sunk ships
+    Bitboard m_hits;                // hits not in a located sunk ship
+    Bitboard m_sinkCells;           // the cells of m_pending
+    GameVector<int> m_open;         // hits that may belong to a ship afloat
+    GameVector<Sink> m_pending;     // sinks not yet located
+    GameVector<int> m_afloat;       // ships afloat of each length
+    mutable GameVector<int> m_run;  // score's running count of hits
+};
+
+#endif // HITTRACKER_INCLUDED
@@ -0,0 +1,153 @@
+#include "HuntPolicy.h"
+#include "Game.h"
+#include <algorithm>
+
+using namespace std;
+
+HuntLattices::HuntLattices(const Game& g)
+ : m_maxStride(1)
+{
+    for (int k = 0; k < g.nShips(); k++)
+        m_maxStride = max(m_maxStride, g.shipLength(k));
+    int nCells = g.rows() * g.cols();
+    int nLattices = lattice(m_maxStride + 1, 0);
+    m_masks.resize(nLattices);
+    m_firstCell.resize(nLattices + 1);
+    m_cells.reserve(m_maxStride * nCells);
+    for (int s = 1; s <= m_maxStride; s++)
+    {
+        for (int o = 0; o < s; o++)
+        {
+            m_firstCell[lattice(s, o)] = (int)m_cells.size();
+            for (int r = 0; r < g.rows(); r++)
+            {
+                for (int c = 0; c < g.cols(); c++)
+                {
+                    if ((r + c) % s == o)
+                    {
+                        m_masks[lattice(s, o)].set(r * g.cols() + c);
+                        m_cells.push_back(r * g.cols() + c);
+                    }
+                }
+            }
+        }
+    }
+    m_firstCell[nLattices] = (int)m_cells.size();
+}
+
+HuntPolicy::HuntPolicy(const Game& g, const HuntLattices& lattices)
+ : m_game(g), m_lattices(lattices), m_cols(g.cols()), m_nCells(g.rows() * g.cols()),
+   m_stride(0), m_offset(-1), m_nUntried(0), m_pos(m_nCells, -1)
+{
+    m_afloat.resize(m_lattices.maxStride() + 1);
+    m_untried.resize(m_nCells);
+    reset();
+}
+
+void HuntPolicy::reset()
+{
+    fill(m_afloat.begin(), m_afloat.end(), 0);
+    for (int k = 0; k < m_game.nShips(); k++)
+        m_afloat[m_game.shipLength(k)]++;
+    m_shot.clear();
+    for (int i = 0; i < m_nUntried; i++)
+        m_pos[m_untried[i]] = -1;
+    m_nUntried = 0;
+    m_offset = -1;
+    setStride();
+}
+
+void HuntPolicy::markShot(Point p)
+{
+    int cell = p.r * m_cols + p.c;
+    m_shot.set(cell);
+    int pos = m_pos[cell];
+    if (pos < 0)
+        return;
+    int last = m_untried[--m_nUntried];
+    m_untried[pos] = last;
+    m_pos[last] = pos;
+    m_pos[cell] = -1;
+}
+
+void HuntPolicy::recordSink(int shipId)
+{
+    int len = m_game.shipLength(shipId);
+    if (m_afloat[len] > 0)
+        m_afloat[len]--;
+    if (len == m_stride)
+        setStride();
+}
+
+// hunt on the shortest ship afloat, choosing the lattice again if that
+// changes the stride
+void HuntPolicy::setStride()
+{
+    int stride = 1;
+    for (int len = 1; len <= m_lattices.maxStride(); len++)
+    {
+        if (m_afloat[len] > 0)
+        {
+            stride = len;
+            break;
+        }
+    }
+    if (stride != m_stride)
+    {
+        m_stride = stride;
+        m_offset = -1;
+    }
+}
+
+// move to the lattice of the current stride with the fewest cells left,
+// taking one at random if several tie, and gather the cells left on it
+void HuntPolicy::chooseLattice(Rng& rng)
+{
+    int fewest = m_nCells + 1;
+    int nTied = 0;
+    for (int o = 0; o < m_stride; o++)
+    {
+        int n = m_lattices.mask(HuntLattices::lattice(m_stride, o)).countExcept(m_shot);
+        if (n < fewest)
+        {
+            fewest = n;
+            nTied = 0;
+        }
+        if (n == fewest  &&  rng.randInt(++nTied) == 0)
+            m_offset = o;
+    }
+
+    for (int i = 0; i < m_nUntried; i++)
+        m_pos[m_untried[i]] = -1;
+    m_nUntried = 0;
+    int l = HuntLattices::lattice(m_stride, m_offset);
+    for (const int* c = m_lattices.begin(l); c != m_lattices.end(l); c++)
+    {
+        int cell = *c;
+        if (!m_shot.test(cell))
+        {
+            m_pos[cell] = m_nUntried;
+            m_untried[m_nUntried++] = cell;
+        }
+    }
+}
+
+bool HuntPolicy::choose(Rng& rng, Point& p)
+{
+    if (m_offset < 0)
+        chooseLattice(rng);
+
+    int cell;
+    if (m_nUntried > 0)
+        cell = m_untried[rng.randInt(m_nUntried)];
+    else
+    {
+        Bitboard left = m_shot.complement(m_nCells);
+        int n = left.count();
+        if (n == 0)
+            return false;
+        cell = left.select(rng.randInt(n));
+    }
+    p = Point(cell / m_cols, cell % m_cols);
+    return true;
+}
@@ -0,0 +1,93 @@
+#ifndef HUNTPOLICY_INCLUDED
+#define HUNTPOLICY_INCLUDED
+
+#include "globals.h"
+#include "Bitboard.h"
+#include "Arena.h"
+
+class Game;
+
+// The lattices a hunt is made on, for every stride from 1 to the longest
+// ship: lattice(s, o) is the cells whose row plus column leaves the
+// remainder o when divided by s.  Each is kept as a bitboard, for counting
+// its cells left, and as a list of its cells in row-major order.  They
+// depend only on the Game, so one set can serve any number of HuntPolicy
+// objects.
+class HuntLattices
+{
+  public:
+    HuntLattices(const Game& g);
+
+      // the longest ship, and so the widest stride
+    int maxStride() const { return m_maxStride; }
+      // the number of lattice(stride, offset), from 0 for stride 1 upward
+    static int lattice(int stride, int offset) { return stride * (stride - 1) / 2 + offset; }
+    const Bitboard& mask(int l) const { return m_masks[l]; }
+      // the cells of lattice number l
+    const int* begin(int l) const { return m_cells.data() + m_firstCell[l]; }
+    const int* end(int l) const { return m_cells.data() + m_firstCell[l+1]; }
+
+  private:
+    int m_maxStride;
+    GameVector<Bitboard> m_masks;
+    GameVector<int> m_cells;            // the cells of every lattice, in turn
+    GameVector<int> m_firstCell;        // where each lattice's cells start
+};
+
+// Chooses where to attack while a player has no hit to follow up.  Every
+// ship of length L or more, across or down, covers a cell of each lattice
+// of cells whose row plus column leaves the same remainder when divided by
+// L, so until the shortest ship afloat has been sunk, attacks off such a
+// lattice can be left for last.  The policy keeps count of the ships
+// afloat as they are sunk, and hunts on a lattice whose stride is the
+// shortest length among them, choosing uniformly among its unattacked
+// cells.  When the stride changes, it moves to the lattice with the fewest
+// unattacked cells left on it; a random one at the start of a game.
+//
+// The lattices come from a HuntLattices worked out beforehand, so choosing
+// a lattice is a popcount of each candidate with the attacked cells taken
+// away.  The unattacked cells of the chosen one are then kept in an array
+// the way ShotTracker keeps a board's, so a choice, and taking away a cell
+// as it is attacked, take constant time.  Once the lattice is used up, the
+// choice is a count and a select on the cells not attacked.
+class HuntPolicy
+{
+  public:
+    HuntPolicy(const Game& g, const HuntLattices& lattices);
+
+      // every ship afloat, nothing attacked
+    void reset();
+
+      // p (which must be on the board) has been attacked; marking a cell
+      // twice is harmless
+    void markShot(Point p);
+
+      // the ship with this shipId has been sunk
+    void recordSink(int shipId);
+
+      // length of the shortest ship afloat (1 if there is none)
+    int stride() const { return m_stride; }
+
+      // set p to a cell not yet attacked, on the lattice if any cell of it
+      // is left and otherwise anywhere; return false if every cell has
+      // been attacked
+    bool choose(Rng& rng, Point& p);
+
+  private:
+    void setStride();
+    void chooseLattice(Rng& rng);
+
+    const Game& m_game;
+    const HuntLattices& m_lattices;
+    int m_cols;
+    int m_nCells;
+    GameVector<int> m_afloat;           // ships afloat of each length
+    Bitboard m_shot;
+    int m_stride;
+    int m_offset;                       // -1 until the lattice is chosen
+    GameVector<int> m_untried;          // the first m_nUntried entries are
+    int m_nUntried;                     //   the lattice's unattacked cells
+    GameVector<int> m_pos;              // where each is in m_untried, or -1
+};
+
+#endif // HUNTPOLICY_INCLUDED
@@ -0,0 +1,170 @@
+#include "Instrumentation.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+static const char* phaseNames[NPHASES] = {
+    "place_ships", "recommend_attack", "record_attack_result", "board_attack"
+};
+
+static const char* counterNames[NCOUNTERS] = {
+    "wasted_shots", "placement_retries", "placement_fallbacks",
+    "target_fallbacks", "sample_rejections"
+};
+
+const char* phaseName(Phase p)
+{
+    return phaseNames[p];
+}
+
+const char* counterName(Counter c)
+{
+    return counterNames[c];
+}
+
+void PlayerStats::clear()
+{
+    for (int i = 0; i < NPHASES; i++)
+        phases[i].calls = phases[i].nanos = 0;
+    for (int i = 0; i < NCOUNTERS; i++)
+        counters[i] = 0;
+}
+
+void PlayerStats::add(const PlayerStats& other)
+{
+    for (int i = 0; i < NPHASES; i++)
+    {
+        phases[i].calls += other.phases[i].calls;
+        phases[i].nanos += other.phases[i].nanos;
+    }
+    for (int i = 0; i < NCOUNTERS; i++)
+        counters[i] += other.counters[i];
+}
+
+static thread_local PlayerStats* current = nullptr;
+
+PlayerStats* setCurrentPlayerStats(PlayerStats* stats)
+{
+    PlayerStats* previous = current;
+    current = stats;
+    return previous;
+}
+
+PlayerStats* currentPlayerStats()
+{
+    return current;
+}
+
+// totals per player type; games only update them once each, so a plain
+// mutex costs nothing worth measuring
+static mutex totalsMutex;
+static map<string, InstrumentationSnapshot::TypeStats> totals;
+
+void recordPlayerStats(const string& type, const PlayerStats& stats)
+{
+    lock_guard<mutex> lock(totalsMutex);
+    InstrumentationSnapshot::TypeStats& t = totals[type];
+    t.type = type;
+    t.games++;
+    t.stats.add(stats);
+}
+
+InstrumentationSnapshot instrumentationSnapshot()
+{
+    InstrumentationSnapshot s;
+#ifdef BATTLESHIP_INSTRUMENT
+    s.enabled = true;
+#else
+    s.enabled = false;
+#endif
+    lock_guard<mutex> lock(totalsMutex);
+    for (map<string, InstrumentationSnapshot::TypeStats>::const_iterator p = totals.begin();
+         p != totals.end(); p++)
+        s.types.push_back(p->second);
+    return s;
+}
+
+void resetInstrumentation()
+{
+    lock_guard<mutex> lock(totalsMutex);
+    totals.clear();
+}
+
+void writePrometheus(const InstrumentationSnapshot& s, ostream& out)
+{
+    out << "# HELP battleship_instrumented Whether the program was built with BATTLESHIP_INSTRUMENT.\n"
+        << "# TYPE battleship_instrumented gauge\n"
+        << "battleship_instrumented " << (s.enabled ? 1 : 0) << "\n";
+
+    out << "# HELP battleship_games_total Games played by players of each type.\n"
+        << "# TYPE battleship_games_total counter\n";
+    for (size_t i = 0; i < s.types.size(); i++)
+        out << "battleship_games_total{player_type=\"" << s.types[i].type
+            << "\"} " << s.types[i].games << "\n";
+
+    out << "# HELP battleship_phase_calls_total Calls made in each phase of play.\n"
+        << "# TYPE battleship_phase_calls_total counter\n";
+    for (size_t i = 0; i < s.types.size(); i++)
+        for (int p = 0; p < NPHASES; p++)
+            out << "battleship_phase_calls_total{player_type=\"" << s.types[i].type
+                << "\",phase=\"" << phaseNames[p] << "\"} "
+                << s.types[i].stats.phases[p].calls << "\n";
+
+    out << "# HELP battleship_phase_seconds_total Time spent in each phase of play.\n"
+        << "# TYPE battleship_phase_seconds_total counter\n";
+    for (size_t i = 0; i < s.types.size(); i++)
+        for (int p = 0; p < NPHASES; p++)
+            out << "battleship_phase_seconds_total{player_type=\"" << s.types[i].type
+                << "\",phase=\"" << phaseNames[p] << "\"} " << setprecision(9)
+                << s.types[i].stats.phases[p].nanos / 1e9 << "\n";
+
+    out << "# HELP battleship_events_total Wasted shots and retries in the players' inner loops.\n"
+        << "# TYPE battleship_events_total counter\n";
+    for (size_t i = 0; i < s.types.size(); i++)
+        for (int c = 0; c < NCOUNTERS; c++)
+            out << "battleship_events_total{player_type=\"" << s.types[i].type
+                << "\",event=\"" << counterNames[c] << "\"} "
+                << s.types[i].stats.counters[c] << "\n";
+}
+
+void writeJson(const InstrumentationSnapshot& s, ostream& out)
+{
+    out << "{\n  \"instrumented\": " << (s.enabled ? "true" : "false")
+        << ",\n  \"player_types\": [";
+    for (size_t i = 0; i < s.types.size(); i++)
+    {
+        const InstrumentationSnapshot::TypeStats& t = s.types[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\n      \"type\": \"" << t.type << "\",\n"
+            << "      \"games\": " << t.games << ",\n      \"phases\": {";
+        for (int p = 0; p < NPHASES; p++)
+            out << (p == 0 ? "\n" : ",\n") << "        \"" << phaseNames[p]
+                << "\": { \"calls\": " << t.stats.phases[p].calls
+                << ", \"nanos\": " << t.stats.phases[p].nanos << " }";
+        out << "\n      },\n      \"events\": {";
+        for (int c = 0; c < NCOUNTERS; c++)
+            out << (c == 0 ? "\n" : ",\n") << "        \"" << counterNames[c]
+                << "\": " << t.stats.counters[c];
+        out << "\n      }\n    }";
+    }
+    out << (s.types.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+bool dumpInstrumentation(const string& path)
+{
+    ofstream out(path);
+    if (!out)
+        return false;
+    InstrumentationSnapshot s = instrumentationSnapshot();
+    if (path.size() >= 5  &&  path.compare(path.size() - 5, 5, ".json") == 0)
+        writeJson(s, out);
+    else
+        writePrometheus(s, out);
+    return bool(out);
+}
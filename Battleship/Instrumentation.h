@@ -0,0 +1,161 @@
+#ifndef INSTRUMENTATION_INCLUDED
+#define INSTRUMENTATION_INCLUDED
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+#include <chrono>
+
+// Where the time of a game goes, and how often the players' inner loops
+// have to retry.  This is compiled in only when BATTLESHIP_INSTRUMENT is
+// defined; otherwise the BS_TIME_PHASE and BS_COUNT hooks compile to
+// nothing and every count stays zero.
+//
+// Each game keeps a PlayerStats for each side.  While a player's code is
+// running, the game makes that side's PlayerStats current on the calling
+// thread (BS_PLAYER_SCOPE), so hooks deep inside the player (or its FleetSampler) know
+// where to count.  At the end of a game both are added to the totals for
+// the players' types.
+
+enum Phase
+{
+    PHASE_PLACE_SHIPS, PHASE_RECOMMEND_ATTACK, PHASE_RECORD_ATTACK_RESULT,
+    PHASE_BOARD_ATTACK, NPHASES
+};
+
+enum Counter
+{
+    COUNTER_WASTED_SHOTS,         // attacks Board::attack rejected
+    COUNTER_PLACEMENT_RETRIES,    // layouts placeShips drew and threw away
+    COUNTER_PLACEMENT_FALLBACKS,  // times placeShips gave up sampling and
+                                  //   used the exact solver
+    COUNTER_TARGET_FALLBACKS,     // times a player's targeting ran out of
+                                  //   cells to try and went back to hunting
+    COUNTER_SAMPLE_REJECTIONS,    // layouts a sampling player threw away
+    NCOUNTERS
+};
+
+const char* phaseName(Phase p);
+const char* counterName(Counter c);
+
+struct PhaseStats
+{
+    uint64_t calls;
+    uint64_t nanos;
+};
+
+struct PlayerStats
+{
+    PlayerStats() { clear(); }
+    void clear();
+    void add(const PlayerStats& other);
+
+    PhaseStats phases[NPHASES];
+    uint64_t counters[NCOUNTERS];
+};
+
+// The totals for every player type seen so far
+struct InstrumentationSnapshot
+{
+    struct TypeStats
+    {
+        TypeStats() : games(0) {}
+
+        std::string type;
+        uint64_t games;
+        PlayerStats stats;
+    };
+
+    bool enabled;           // whether this build was instrumented
+    std::vector<TypeStats> types;
+};
+
+  // Make stats the target of BS_COUNT on this thread (nullptr for none)
+  // and return the previous target
+PlayerStats* setCurrentPlayerStats(PlayerStats* stats);
+PlayerStats* currentPlayerStats();
+
+  // Add one game's stats for a player of the given type to the totals;
+  // safe to call from several threads at once
+void recordPlayerStats(const std::string& type, const PlayerStats& stats);
+
+InstrumentationSnapshot instrumentationSnapshot();
+void resetInstrumentation();
+
+void writePrometheus(const InstrumentationSnapshot& s, std::ostream& out);
+void writeJson(const InstrumentationSnapshot& s, std::ostream& out);
+
+  // Write the totals to a file, as JSON if its name ends in .json and in
+  // the Prometheus text format otherwise; return false if it can't be
+  // written
+bool dumpInstrumentation(const std::string& path);
+
+#ifdef BATTLESHIP_INSTRUMENT
+
+// Adds the time from its construction to its destruction to a phase
+class PhaseTimer
+{
+  public:
+    PhaseTimer(PlayerStats* stats, Phase p)
+     : m_stats(stats), m_phase(p), m_start(std::chrono::steady_clock::now())
+    {}
+
+    ~PhaseTimer()
+    {
+        if (m_stats == nullptr)
+            return;
+        PhaseStats& ps = m_stats->phases[m_phase];
+        ps.calls++;
+        ps.nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+  private:
+    PlayerStats* m_stats;
+    Phase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+inline void countEvent(Counter c, uint64_t n)
+{
+    PlayerStats* stats = currentPlayerStats();
+    if (stats != nullptr)
+        stats->counters[c] += n;
+}
+
+#define BS_CONCAT2(a, b) a##b
+#define BS_CONCAT(a, b) BS_CONCAT2(a, b)
+#define BS_TIME_PHASE(stats, phase) \
+    PhaseTimer BS_CONCAT(bsPhaseTimer, __LINE__)(stats, phase)
+#define BS_COUNT(counter, n) countEvent(counter, n)
+
+// Makes a PlayerStats current until the end of the enclosing scope
+class CurrentPlayerStats
+{
+  public:
+    CurrentPlayerStats(PlayerStats* stats) : m_previous(setCurrentPlayerStats(stats)) {}
+    ~CurrentPlayerStats() { setCurrentPlayerStats(m_previous); }
+    CurrentPlayerStats(const CurrentPlayerStats&) = delete;
+    CurrentPlayerStats& operator=(const CurrentPlayerStats&) = delete;
+
+  private:
+    PlayerStats* m_previous;
+};
+
+#define BS_PLAYER_SCOPE(stats) \
+    CurrentPlayerStats BS_CONCAT(bsPlayerScope, __LINE__)(stats)
+
+#else
+
+  // the arguments are still compiled, but never evaluated
+#define BS_TIME_PHASE(stats, phase) ((void)sizeof(stats))
+#define BS_COUNT(counter, n) ((void)sizeof(n))
+#define BS_PLAYER_SCOPE(stats) ((void)sizeof(stats))
+
+#endif // BATTLESHIP_INSTRUMENT
+
+#endif // INSTRUMENTATION_INCLUDED
@@ -0,0 +1,23 @@
+#include "PlacementMasks.h"
+
+using namespace std;
+
+// The sizes with a table.  Each is built by the compiler; the standard
+// 10 x 10 board's covers every ship length in about 35K.
+static constexpr PlacementMaskTable<10, 10> standardMasks;
+
+static_assert(standardMasks.mask(5, HORIZONTAL, 0)[0] == 0x1f,
+              "an aircraft carrier in the corner covers the first five cells");
+static_assert(standardMasks.mask(2, VERTICAL, 90)[1] == 0,
+              "a ship can't start on the bottom row going down");
+static_assert(standardMasks.starts(10, HORIZONTAL)[0] ==
+                  (1ULL | 1ULL << 10 | 1ULL << 20 | 1ULL << 30 | 1ULL << 40 |
+                   1ULL << 50 | 1ULL << 60),
+              "a ship as long as a row only starts at the left edge");
+
+PlacementMasks placementMasks(int rows, int cols)
+{
+    if (rows == 10  &&  cols == 10)
+        return PlacementMasks(standardMasks);
+    return PlacementMasks();
+}
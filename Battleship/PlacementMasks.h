@@ -0,0 +1,108 @@
+#ifndef PLACEMENTMASKS_INCLUDED
+#define PLACEMENTMASKS_INCLUDED
+
+#include "globals.h"
+#include <cstdint>
+
+// The cells of every ship placement on a board of a size fixed at compile
+// time, as bitboard words: a ship of length len starting at cell start and
+// running in direction dir covers exactly the cells of
+// mask(len, dir, start), so whether it fits among some occupied cells is
+// one AND per word.  A table also holds, for each length and direction,
+// the set of cells a ship can start from without running off the board.
+//
+// Building a table is constexpr, so a table declared constexpr is worked
+// out entirely by the compiler; the tables for the sizes in
+// PlacementMasks.cpp are, and placementMasks() finds the one for a board.
+template <int ROWS, int COLS>
+class PlacementMaskTable
+{
+  public:
+    static const int CELLS = ROWS * COLS;
+    static const int WORDS = (CELLS + 63) / 64;
+    static const int MAXLEN = (ROWS > COLS ? ROWS : COLS);
+
+    constexpr PlacementMaskTable() : m_masks(), m_starts()
+    {
+        for (int len = 1; len <= MAXLEN; len++)
+        {
+            for (int d = 0; d < 2; d++)
+            {
+                int step = (d == HORIZONTAL ? 1 : COLS);
+                for (int r = 0; r < ROWS; r++)
+                {
+                    for (int c = 0; c < COLS; c++)
+                    {
+                        if ((d == HORIZONTAL ? c : r) + len > (d == HORIZONTAL ? COLS : ROWS))
+                            continue;
+                        int start = r * COLS + c;
+                        m_starts[len][d][start / 64] |= uint64_t(1) << (start % 64);
+                        for (int k = 0, cell = start; k < len; k++, cell += step)
+                            m_masks[len][d][start][cell / 64] |= uint64_t(1) << (cell % 64);
+                    }
+                }
+            }
+        }
+    }
+
+      // all zero if the ship would run off the board
+    constexpr const uint64_t* mask(int len, Direction dir, int start) const
+    {
+        return m_masks[len][dir][start];
+    }
+
+    constexpr const uint64_t* starts(int len, Direction dir) const
+    {
+        return m_starts[len][dir];
+    }
+
+  private:
+    uint64_t m_masks[MAXLEN+1][2][CELLS][WORDS];
+    uint64_t m_starts[MAXLEN+1][2][WORDS];
+};
+
+// A compile-time table seen at run time, for a board whose size is only
+// known then.  It is empty (available() is false) for sizes that have no
+// table; for them, callers go cell by cell instead.  A table's start sets
+// always cover the whole board, so a start set built cell by cell must be
+// made as wide as the board too, or shifting it will lose cells.
+class PlacementMasks
+{
+  public:
+    PlacementMasks() : m_masks(nullptr), m_starts(nullptr), m_cells(0), m_words(0), m_maxLen(0) {}
+
+    template <int ROWS, int COLS>
+    PlacementMasks(const PlacementMaskTable<ROWS, COLS>& table)
+     : m_masks(table.mask(0, HORIZONTAL, 0)), m_starts(table.starts(0, HORIZONTAL)),
+       m_cells(ROWS * COLS), m_words(PlacementMaskTable<ROWS, COLS>::WORDS),
+       m_maxLen(PlacementMaskTable<ROWS, COLS>::MAXLEN)
+    {}
+
+      // whether there is a table, and it covers ships of length len
+    bool available() const { return m_masks != nullptr; }
+    bool covers(int len) const { return available()  &&  len >= 1  &&  len <= m_maxLen; }
+    int nWords() const { return m_words; }
+
+      // start must be a cell of the board
+    const uint64_t* mask(int len, Direction dir, int start) const
+    {
+        return m_masks + ((len * 2 + dir) * m_cells + start) * m_words;
+    }
+
+    const uint64_t* starts(int len, Direction dir) const
+    {
+        return m_starts + (len * 2 + dir) * m_words;
+    }
+
+  private:
+    const uint64_t* m_masks;
+    const uint64_t* m_starts;
+    int m_cells;
+    int m_words;
+    int m_maxLen;
+};
+
+  // the table for a board of this size, or an empty one if there is none
+PlacementMasks placementMasks(int rows, int cols);
+
+#endif // PLACEMENTMASKS_INCLUDED
@@ -0,0 +1,176 @@
+#include "PlacementSolver.h"
+#include "Board.h"
+#include "Game.h"
+#include "globals.h"
+#include <vector>
+#include <climits>
+
+using namespace std;
+
+PlacementSolver::PlacementSolver(const Game& g)
+ : m_game(g), m_nCells(g.rows() * g.cols())
+{
+    PlacementMasks masks = placementMasks(g.rows(), g.cols());
+    for (int s = 0; s < m_game.nShips(); s++)
+    {
+        int len = m_game.shipLength(s);
+        if (len >= (int)m_byLength.size())
+            m_byLength.resize(len+1);
+        if (!m_byLength[len].empty())
+            continue;
+        m_lengths.push_back(len);
+
+        for (int r = 0; r < m_game.rows(); r++)
+        {
+            for (int c = 0; c < m_game.cols(); c++)
+            {
+                for (int d = 0; d < 2; d++)
+                {
+                    Placement p;
+                    p.topOrLeft = Point(r, c);
+                    p.dir = (d == 0 ? HORIZONTAL : VERTICAL);
+                    if ((p.dir == HORIZONTAL ? c : r) + len >
+                        (p.dir == HORIZONTAL ? m_game.cols() : m_game.rows()))
+                        continue;
+                      // a ship of length 1 fits the same way in both directions
+                    if (len == 1  &&  p.dir == VERTICAL)
+                        continue;
+                    p.first = r * m_game.cols() + c;
+                    p.step = (p.dir == HORIZONTAL ? 1 : m_game.cols());
+                    p.length = len;
+                    if (masks.covers(len))
+                    {
+                        p.mask = masks.mask(len, p.dir, p.first);
+                        p.maskWords = masks.nWords();
+                    }
+                    m_byLength[len].push_back(p);
+                }
+            }
+        }
+    }
+}
+
+const GameVector<Placement>& PlacementSolver::placements(int len) const
+{
+    return m_byLength[len];
+}
+
+bool PlacementSolver::solve(const Bitboard& forbidden, GameVector<Placement>& fleet)
+{
+    m_left.assign(m_lengths.size(), 0);
+    m_lastIndex.assign(m_lengths.size(), -1);
+    m_chosen.assign(m_lengths.size(), GameVector<int>());
+    int cellsNeeded = 0;
+    for (int s = 0; s < m_game.nShips(); s++)
+    {
+        for (size_t i = 0; i < m_lengths.size(); i++)
+            if (m_lengths[i] == m_game.shipLength(s))
+                m_left[i]++;
+        cellsNeeded += m_game.shipLength(s);
+    }
+
+    Bitboard occupied = forbidden;
+    if (!search(occupied, m_nCells - forbidden.count(), cellsNeeded))
+        return false;
+
+      // hand out the chosen placements of each length to the ships of
+      // that length in shipId order
+    fleet.resize(m_game.nShips());
+    vector<int> used(m_lengths.size(), 0);
+    for (int s = 0; s < m_game.nShips(); s++)
+    {
+        for (size_t i = 0; i < m_lengths.size(); i++)
+        {
+            if (m_lengths[i] == m_game.shipLength(s))
+            {
+                fleet[s] = m_byLength[m_lengths[i]][m_chosen[i][used[i]++]];
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+// occupied is restored before returning false
+bool PlacementSolver::search(Bitboard& occupied, int freeCells, int cellsNeeded)
+{
+    if (cellsNeeded == 0)
+        return true;
+    if (freeCells < cellsNeeded)
+        return false;
+
+      // pick the length with the fewest placements left to try
+    int best = -1;
+    int bestCount = INT_MAX;
+    for (size_t i = 0; i < m_lengths.size(); i++)
+    {
+        if (m_left[i] == 0)
+            continue;
+        const GameVector<Placement>& all = m_byLength[m_lengths[i]];
+        int count = 0;
+        for (int j = m_lastIndex[i] + 1; j < (int)all.size(); j++)
+            if (!all[j].overlaps(occupied))
+                count++;
+        if (count < m_left[i])
+            return false;
+        if (count < bestCount)
+        {
+            best = (int)i;
+            bestCount = count;
+        }
+    }
+
+    int len = m_lengths[best];
+    const GameVector<Placement>& all = m_byLength[len];
+    int savedLast = m_lastIndex[best];
+    m_left[best]--;
+    for (int j = savedLast + 1; j < (int)all.size(); j++)
+    {
+        if (all[j].overlaps(occupied))
+            continue;
+        m_lastIndex[best] = j;
+        m_chosen[best].push_back(j);
+        all[j].addTo(occupied);
+        if (search(occupied, freeCells - len, cellsNeeded - len))
+            return true;
+        all[j].removeFrom(occupied);
+        m_chosen[best].pop_back();
+    }
+    m_lastIndex[best] = savedLast;
+    m_left[best]++;
+    return false;
+}
+
+Bitboard PlacementSolver::randomBlock(Rng& rng) const
+{
+      // a partial Fisher-Yates shuffle of the cells
+    vector<int> cells(m_nCells);
+    for (int i = 0; i < m_nCells; i++)
+        cells[i] = i;
+    Bitboard blocked;
+    for (int i = 0; i < m_nCells / 2; i++)
+    {
+        int j = i + rng.randInt(m_nCells - i);
+        swap(cells[i], cells[j]);
+        blocked.set(cells[i]);
+    }
+    return blocked;
+}
+
+bool PlacementSolver::place(Board& b, const GameVector<Placement>& fleet) const
+{
+    for (int s = 0; s < (int)fleet.size(); s++)
+    {
+        if (!b.placeShip(fleet[s].topOrLeft, s, fleet[s].dir))
+            return false;
+    }
+    return true;
+}
+
+bool PlacementSolver::placeFleet(Board& b, Rng& rng)
+{
+    GameVector<Placement> fleet;
+    if (!solve(randomBlock(rng), fleet)  &&  !solve(Bitboard(), fleet))
+        return false;
+    return place(b, fleet);
+}
@@ -0,0 +1,103 @@
+#ifndef PLACEMENTSOLVER_INCLUDED
+#define PLACEMENTSOLVER_INCLUDED
+
+#include "globals.h"
+#include "Bitboard.h"
+#include "Arena.h"
+#include "PlacementMasks.h"
+#include <vector>
+
+class Game;
+class Board;
+
+// One way to put a ship on the board.  Its cells are first, first+step,
+// ..., for length cells; the cells aren't stored as a Bitboard, since on a
+// large board that would take far more memory than the ship does.  On a
+// board with a compile-time PlacementMasks table, mask points to the
+// placement's cells there, so testing and marking them is a word at a time.
+struct Placement
+{
+    Point topOrLeft;
+    Direction dir;
+    int first;
+    int step;       // 1 for a horizontal ship, the number of columns for a vertical one
+    int length;
+    const uint64_t* mask = nullptr; // maskWords words, or nullptr
+    int maskWords = 0;
+
+    bool overlaps(const Bitboard& b) const
+    {
+        if (mask != nullptr)
+            return b.intersects(mask, maskWords);
+        for (int k = 0, cell = first; k < length; k++, cell += step)
+            if (b.test(cell))
+                return true;
+        return false;
+    }
+
+    void addTo(Bitboard& b) const
+    {
+        if (mask != nullptr)
+        {
+            b.add(mask, maskWords);
+            return;
+        }
+        for (int k = 0, cell = first; k < length; k++, cell += step)
+            b.set(cell);
+    }
+
+    void removeFrom(Bitboard& b) const
+    {
+        if (mask != nullptr)
+        {
+            b.subtract(mask, maskWords);
+            return;
+        }
+        for (int k = 0, cell = first; k < length; k++, cell += step)
+            b.reset(cell);
+    }
+};
+
+// Finds a position for every ship of a game so that no two overlap.  All
+// placements of each ship length are worked out once; the search then
+// places one ship at a time, always choosing the length with the fewest
+// placements still available, and undoes choices that leave some ship
+// with nowhere to go.  Ships of equal length are interchangeable,
+// so they are placed in increasing placement order, which keeps the search
+// from trying the same layout more than once.  The search is exhaustive: if
+// solve() returns false, no layout exists.
+class PlacementSolver
+{
+  public:
+    PlacementSolver(const Game& g);
+
+      // every placement of a ship of length len on an empty board
+    const GameVector<Placement>& placements(int len) const;
+
+      // fill fleet (indexed by shipId) with a layout that avoids the
+      // forbidden cells; return false if there is none
+    bool solve(const Bitboard& forbidden, GameVector<Placement>& fleet);
+
+      // half of the board's cells, chosen at random
+    Bitboard randomBlock(Rng& rng) const;
+
+      // put a solved fleet on an empty board
+    bool place(Board& b, const GameVector<Placement>& fleet) const;
+
+      // lay out the fleet avoiding a randomly blocked half of the board if
+      // possible, or anywhere if not; return false if the ships can't fit
+    bool placeFleet(Board& b, Rng& rng);
+
+  private:
+    bool search(Bitboard& occupied, int freeCells, int cellsNeeded);
+
+    const Game& m_game;
+    int m_nCells;
+    GameVector<GameVector<Placement> > m_byLength;  // indexed by length
+    GameVector<int> m_lengths;      // the distinct ship lengths
+    GameVector<int> m_left;         // ships of each length not yet placed
+    GameVector<int> m_lastIndex;    // placement most recently used for each length
+    GameVector<GameVector<int> > m_chosen;  // placements used for each length
+};
+
+#endif // PLACEMENTSOLVER_INCLUDED
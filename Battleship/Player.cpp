@@ -2,11 +2,22 @@
 #include "Board.h"
 #include "Game.h"
 #include "globals.h"
+#include "Bitboard.h"
+#include "ShotTracker.h"
+#include "HitTracker.h"
+#include "HuntPolicy.h"
+#include "FleetSampler.h"
+#include "PlacementMasks.h"
+#include "Instrumentation.h"
+#include "ThreadPool.h"
 #include <iostream>
 #include <string>
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cassert>
 
 using namespace std;
 
@@ -18,11 +29,13 @@ class AwfulPlayer : public Player
 {
   public:
     AwfulPlayer(string nm, const Game& g);
+    virtual string type() const { return "awful"; }
     virtual bool placeShips(Board& b);
     virtual Point recommendAttack();
     virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
                                                 bool shipDestroyed, int shipId);
     virtual void recordAttackByOpponent(Point p);
+    virtual void reset();
   private:
     Point m_lastCellAttacked;
 };
@@ -71,6 +84,11 @@ void AwfulPlayer::recordAttackByOpponent(Point /* p */)
       // AwfulPlayer completely ignores what the opponent does
 }
 
+void AwfulPlayer::reset()
+{
+    m_lastCellAttacked = Point(0, 0);
+}
+
 //*********************************************************************
 //  HumanPlayer
 //*********************************************************************
@@ -91,12 +109,13 @@ class HumanPlayer : public Player
 {
   public:
     HumanPlayer(string nm, const Game& g);
+    virtual string type() const { return "human"; }
     virtual bool isHuman() const { return true; }
     virtual bool placeShips(Board& b);
     virtual Point recommendAttack();
     virtual void recordAttackResult(Point p, bool validShot, bool shotHit,bool shipDestroyed, int shipId);
     virtual void recordAttackByOpponent(Point p);
-    
+    virtual void reset();
 };
 
 HumanPlayer::HumanPlayer(string nm, const Game& g):Player(nm, g)
@@ -184,99 +203,43 @@ void HumanPlayer::recordAttackByOpponent(Point p)
 {
 }
 
+// everything a human player knows is in the human's head
+void HumanPlayer::reset()
+{
+}
+
 //*********************************************************************
 //  MediocrePlayer
 //*********************************************************************
 
-// TODO:  You need to replace this with a real class declaration and
-//        implementation.
-// Remember that Mediocre::placeShips(Board& b) must start by calling
-// b.block(), and must call b.unblock() just before returning.
-
 class MediocrePlayer : public Player
 {
   public:
     MediocrePlayer(string nm, const Game& g);
-    bool configExist(Board& b, int shipN);
+    virtual string type() const { return "mediocre"; }
     virtual bool placeShips(Board& b);
     virtual Point recommendAttack();
     virtual void recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId);
     virtual void recordAttackByOpponent(Point p);
+    virtual void reset();
     
   private:
-    vector<double> pointVec;
-    vector<Point> unAttacked;
+    ShotTracker shots;
+    HuntLattices lattices;
+    HuntPolicy hunt;
+    FleetSampler sampler;
     Point lastHit;
     int state;
 };
 
-MediocrePlayer::MediocrePlayer(string nm, const Game& g):Player(nm, g), state(1)
-{
-    // initialize a vector including all points on board, because they are all unattacked at first
-    for (int i=0; i<game().rows(); i++)
-    {
-        for (int j=0; j<game().cols(); j++)
-        {
-            unAttacked.push_back(Point(i, j));
-        }
-    }
-}
-
-// a recursive function that determine whether there is ship placement possible on given board
-// called later in placeShip
-bool MediocrePlayer::configExist(Board& b, int shipN)
-{
-    for (int i=0; i<game().rows(); i++)
-    {
-        for (int j=0; j<game().cols(); j++)
-        {
-            Point p = Point(i, j);
-            if (b.placeShip(p, shipN, HORIZONTAL))
-            {
-                // base case, when we successfully place the last ship horizontally, the whole function return true
-                if (shipN == 0)
-                    return true;
-                
-                // see if we can place the next ship on board
-                bool result = configExist(b, shipN-1);
-                
-                // if later ships cannot be placed, unplace the current ship
-                if (!result)
-                    b.unplaceShip(p, shipN, HORIZONTAL);
-                return result;
-            }
-            
-            // if attempt above with horizontal direction failed, we will try vertical;
-            // if both direction failed, we will return false
-            if (b.placeShip(p, shipN, VERTICAL))
-            {
-                if (shipN == 0)
-                    return true;
-                bool result = configExist(b, shipN-1);
-                if (!result)
-                    b.unplaceShip(p, shipN, VERTICAL);
-                return result;
-            }
-        }
-    }
-    return false;
-}
+// every cell starts out unattacked
+MediocrePlayer::MediocrePlayer(string nm, const Game& g):Player(nm, g), shots(g.rows(), g.cols()), lattices(g), hunt(g, lattices), sampler(g), state(1)
+{}
 
-// place ship by first blocking half of the board and the unblock it after successfully placed
+// place ships in a layout chosen uniformly from all legal layouts
 bool MediocrePlayer::placeShips(Board& b)
 {
-    for (int i=0; i<50; i++)
-    {
-        b.block();
-        if (configExist(b, game().nShips()-1))
-        {
-            b.unblock();
-            return true;
-            break;
-        }
-        b.clear();
-    }
-    return false;
+    return sampler.placeFleet(b, game().rng());
 }
 
 // this function record the result of each attack so our player know which state he is in
@@ -288,7 +251,10 @@ void MediocrePlayer::recordAttackResult(Point p, bool validShot, bool shotHit, b
         {
             // if any ship was destroyed, immediately go back to state 1
             if (shipDestroyed)
+            {
                 state = 1;
+                hunt.recordSink(shipId);
+            }
             // if we hit something but do not destroy anything, we are in state 2, regardless of current state
             
             else
@@ -308,83 +274,43 @@ Point MediocrePlayer::recommendAttack()
 {
     if (state == 2)
     {
-        // if we are in state 2, we will choose random points from unattacked points on the board
-        // I did so by choosing random index in unAttacked
-        while(true)
+        // if we are in state 2, we choose a random unattacked point within the +-4 "cross" of our last hit
+        Point cross[16];
+        int nCandidates = 0;
+        for (int d=1; d<=4; d++)
         {
-            int rand = randInt((int)unAttacked.size());
-            Point p = unAttacked[rand];
-            
-            vector<double>::iterator iter = find (pointVec.begin(), pointVec.end(), p.r*game().cols() + p.c);
-            
-            // if p is not attacked before, and p is within the +-4 range of our last hit, we will return p after push back p to pointVec and delete p from unAttacked, since it is now attacked
-            if (iter == pointVec.end() && ((abs(p.r-lastHit.r) <= 4 && p.c == lastHit.c) || (abs(p.c-lastHit.c)<=4 && p.r == lastHit.r)))
+            Point around[4] = {
+                Point(lastHit.r+d, lastHit.c), Point(lastHit.r-d, lastHit.c),
+                Point(lastHit.r, lastHit.c+d), Point(lastHit.r, lastHit.c-d)
+            };
+            for (int k=0; k<4; k++)
             {
-                pointVec.push_back(p.r*game().cols() + p.c);
-                unAttacked.erase(unAttacked.begin()+rand);
-                return p;
-                break;
+                if (game().isValid(around[k]) && !shots.isShot(around[k]))
+                    cross[nCandidates++] = around[k];
             }
         }
         
-        int tryCount = 0;
-        int order = 0;
-        
-        // this loops counts how many tries we have done in state 2
-        // we will go back to state 1 after we have attacked all points in the +-4 "cross" of lasthit and we still did not destroy any ship because some ship has length longer than 5
-        for (int i=0; i<16; i++)
+        if (nCandidates > 0)
         {
-            if (i%4==0 && i!=0)
-                order++;
-            Point p;
-            
-            if (order==0)
-                p = Point(lastHit.r+i%4+1, lastHit.c);
-            else if (order==1)
-                p = Point(lastHit.r-i%4-1, lastHit.c);
-            else if (order==2)
-                p = Point(lastHit.r, lastHit.c+i%4+1);
-            else if (order==3)
-                p = Point(lastHit.r, lastHit.c-i%4-1);
-            
-            vector<double>::iterator iter = find (pointVec.begin(), pointVec.end(), p.r*game().cols() + p.c);
-
-            // we count both invalid points and attacked points as a "try"
-            if (!game().isValid(p) || iter != pointVec.end())
-            {
-                tryCount++;
-            }
-        }
-        
-        // if we have tried all 16 points, go back to state 1
-        if (tryCount==16)
-        {
-            state = 1;
+            Point p = cross[game().rng().randInt(nCandidates)];
+            shots.markShot(p);
+            hunt.markShot(p);
+            return p;
         }
         
+        // we go back to state 1 after we have attacked all points in the cross and still did not destroy any ship because some ship has length longer than 5
+        state = 1;
+        BS_COUNT(COUNTER_TARGET_FALLBACKS, 1);
     }
     
-    if (state == 1)
+    // in state 1, we choose a random unattacked point, only on cells the
+    // shortest ship afloat can't avoid while there are any
+    Point p;
+    if (state == 1 && hunt.choose(game().rng(), p))
     {
-        // in state 1, we choose random unattacked point and return it if it has not been attacked before
-        while(true)
-        {
-            int rand = randInt((int)unAttacked.size());
-            Point p = unAttacked[rand];
-            
-            vector<double>::iterator iter = find (pointVec.begin(), pointVec.end(), p.r*game().cols() + p.c);
-            
-            // if p is unattacked, attack p now
-            if (iter == pointVec.end())
-            {
-                // push p back to attacked vector pointVec and delete p in unAttacked
-                pointVec.push_back(p.r*game().cols() + p.c);
-                unAttacked.erase(unAttacked.begin()+rand);
-                return p;
-                break;
-            }
-        }
-    
+        shots.markShot(p);
+        hunt.markShot(p);
+        return p;
     }
     return Point();
 }
@@ -392,400 +318,761 @@ Point MediocrePlayer::recommendAttack()
 void MediocrePlayer::recordAttackByOpponent(Point p)
 {}
 
+// the sampler has nothing to forget: it doesn't depend on the game so far
+void MediocrePlayer::reset()
+{
+    shots.reset();
+    hunt.reset();
+    state = 1;
+}
+
 //*********************************************************************
 //  GoodPlayer
 //*********************************************************************
 
-// here is the constructor of a good player
-// Point firstHit and lastHit are used to keep track of which point we want our recommendation to start with
-// fake_board is a 2d array GoodPlayer use to record its valid attack and destroy result
-// alreadyAttack is a vector with double computing by p.r*cols+p.c of a attacked point p
-// length is a vector with int recording all length of existing ship on the board
+// GoodPlayer hunts at random on a lattice spaced by the shortest ship still
+// afloat, which a HuntPolicy keeps.  Once it has a hit, a HitTracker keeps
+// track of the hits not yet known to be part of a sunk ship, and it fires
+// next to one of them, where the ships afloat fit the most ways (so a line
+// of hits is followed to its end), until none is left that a ship afloat
+// could cover.  Between them, the two know every point we have attacked.
 class GoodPlayer : public Player
 {
   public:
     GoodPlayer(string nm, const Game& g);
-    bool configExist(Board& b, int shipN);
+    virtual string type() const { return "good"; }
     virtual bool placeShips(Board& b);
     virtual Point recommendAttack();
     virtual void recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId);
     virtual void recordAttackByOpponent(Point p);
+    virtual void reset();
   private:
-    int state, rowIter, colIter, direction;
-    Point firstHit, lastHit;
-    char fake_board [MAXROWS][MAXCOLS];
-    vector<double> alreadyAttack;
-    vector<int> length;
+    HitTracker hits;
+    HuntLattices lattices;
+    HuntPolicy hunt;
+    FleetSampler sampler;
 };
 
-GoodPlayer::GoodPlayer(string nm, const Game& g):Player(nm, g)
+GoodPlayer::GoodPlayer(string nm, const Game& g):Player(nm, g), hits(g), lattices(g), hunt(g, lattices), sampler(g)
 {
-    state = 1;
-    direction = 0;
+    GoodPlayer::reset();
+}
+
+// start with every ship afloat and nothing attacked; the trackers keep
+// their memory from game to game
+void GoodPlayer::reset()
+{
+    hits.reset();
+    hunt.reset();
+}
+
+// same strategy as MediocrePlayer; only return false if no placement possible at all
+bool GoodPlayer::placeShips(Board& b)
+{
+    return sampler.placeFleet(b, game().rng());
+}
+
+Point GoodPlayer::recommendAttack()
+{
+    Point p;
     
-    // push back length of each ship to vector length
-    for (int i=0; i<game().nShips(); i++)
+    // while there are hits a ship afloat could cover, we fire next to one;
+    // otherwise we hunt
+    if ((hits.hasOpenHits() && hits.target(p)) ||
+        hunt.choose(game().rng(), p))
     {
-        length.push_back(game().shipLength(i));
+        hunt.markShot(p);
+        return p;
     }
+    return Point();
+}
+
+void GoodPlayer::recordAttackByOpponent(Point p)
+{}
+
+// this function record the result of each attack
+void GoodPlayer::recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId)
+{
+    if (!validShot || !game().isValid(p))
+        return;
     
-    rowIter = colIter = 0;
-    
-    // initialize a fake board with all dots
-    for (int i=0; i<MAXROWS; i++)
+    if (!shotHit)
+        hits.recordMiss(p);
+    else if (shipDestroyed)
     {
-        for (int j=0; j<MAXCOLS; j++)
-            fake_board[i][j] = '.';
+        hits.recordSink(p, shipId);
+        hunt.recordSink(shipId);
     }
+    else
+        hits.recordHit(p);
 }
 
-// same function with the one in MediocrePlayer, return true if ships are succesfully placed; false otherwise
-bool GoodPlayer::configExist(Board& b, int shipN)
+//*********************************************************************
+//  OptimalPlayer
+//*********************************************************************
+
+// OptimalPlayer places its ships the way GoodPlayer does, but attacks by
+// probability density: each turn it counts, for every cell, how many ways
+// the ships it hasn't sunk yet could be placed over that cell without
+// touching a miss or a sunk ship, and fires at a cell with the most.  While
+// it has hits that don't belong to a sunk ship, only placements covering at
+// least one of those hits are counted.  A HitTracker works out which hits
+// belong to the ships it sinks, even when ships lie side by side.
+//
+// All of this is done on bitboards: the legal starting cells for a ship of
+// length L are the allowed starts ANDed with the free cells shifted by
+// 0..L-1 (1 per cell horizontally, a row per cell vertically), and the
+// counts are kept in a bit-sliced BitboardCounter.  The count over all
+// placements is kept from move to move: when a cell stops being free, only
+// the placements through it are taken away, and when a ship is sunk, its
+// own placements.  The count of placements covering the hits is made each
+// move from the placements through each hit, which are few.
+class OptimalPlayer : public GoodPlayer
+{
+  public:
+    OptimalPlayer(string nm, const Game& g);
+    virtual string type() const { return "optimal"; }
+    virtual Point recommendAttack();
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId);
+    virtual void reset();
+  protected:
+    int cellOf(Point p) const { return p.r * game().cols() + p.c; }
+    bool addPlacements(BitboardCounter& density, const Bitboard& free, const Bitboard& mustCover, int len, bool remove = false) const;
+    void placement(int start, int len, int d, Bitboard& cells) const;
+    void freeRun(int cell, int d, int& before, int& after) const;
+    void block(int cell);
+
+    int nCells;
+    int maxLength;
+    PlacementMasks masks;       // empty unless the board's size has a table
+    Bitboard shot;              // cells we have attacked
+    HitTracker tracker;         // which hits belong to the ships we have sunk
+    Bitboard blocked;           // cells taken out of huntDensity
+    BitboardCounter huntDensity;    // placements of the ships afloat clear of blocked
+    GameVector<int> length;     // lengths of the ships still afloat
+    GameVector<int> afloat;     // shipIds of the ships still afloat
+    GameVector<Bitboard> hStarts;   // hStarts[L]: cells where a horizontal ship of length L fits on the board
+    GameVector<Bitboard> vStarts;   // vStarts[L]: the same for vertical ships
+};
+
+OptimalPlayer::OptimalPlayer(string nm, const Game& g):GoodPlayer(nm, g), tracker(g)
 {
-    for (int i=0; i<game().rows(); i++)
+    nCells = game().rows()*game().cols();
+    masks = placementMasks(game().rows(), game().cols());
+    
+    maxLength = 0;
+    for (int i=0; i<game().nShips(); i++)
+        maxLength = max(maxLength, game().shipLength(i));
+    
+    // these depend only on the board size, so work them out once, or take
+    // them from the compile-time table if the board's size has one.  They
+    // are made as wide as the board: a shift keeps its source's width, so
+    // addPlacements would lose the cells past the highest start otherwise.
+    hStarts.assign(maxLength+1, Bitboard(nCells));
+    vStarts.assign(maxLength+1, Bitboard(nCells));
+    for (int len=1; len<=maxLength; len++)
     {
-        for (int j=0; j<game().cols(); j++)
+        if (masks.covers(len))
         {
-            Point p = Point(i, j);
-            if (b.placeShip(p, shipN, HORIZONTAL))
-            {
-                if (shipN == 0)
-                    return true;
-                bool result = configExist(b, shipN-1);
-                if (!result)
-                    b.unplaceShip(p, shipN, HORIZONTAL);
-                return result;
-            }
-            
-            
-            if (b.placeShip(p, shipN, VERTICAL))
+            hStarts[len].add(masks.starts(len, HORIZONTAL), masks.nWords());
+            vStarts[len].add(masks.starts(len, VERTICAL), masks.nWords());
+            continue;
+        }
+        for (int i=0; i<game().rows(); i++)
+        {
+            for (int j=0; j<game().cols(); j++)
             {
-                if (shipN == 0)
-                    return true;
-                bool result = configExist(b, shipN-1);
-                if (!result)
-                    b.unplaceShip(p, shipN, VERTICAL);
-                return result;
+                if (j+len <= game().cols())
+                    hStarts[len].set(cellOf(Point(i, j)));
+                if (i+len <= game().rows())
+                    vStarts[len].set(cellOf(Point(i, j)));
             }
         }
     }
-    return false;
+    
+    // shifting the starts onto a ship's last cell must drop none of them,
+    // or the narrow set would give less density than the full-width one
+    for (int len=1; len<=maxLength; len++)
+    {
+        assert((hStarts[len] << (len-1)).count() == hStarts[len].count());
+        assert((vStarts[len] << ((len-1)*game().cols())).count() == vStarts[len].count());
+    }
+    OptimalPlayer::reset();
 }
 
-// similar placeShips strategy as MediocrePlayer, but will try placing ship without blocking any spot on board to see if any placement possible after 50 failure with first blocking
-// only return false if no placement possible at all
-bool GoodPlayer::placeShips(Board& b)
+void OptimalPlayer::reset()
 {
-    for (int i=0; i<50; i++)
+    GoodPlayer::reset();
+    shot.clear();
+    tracker.reset();
+    blocked.clear();
+    huntDensity.clear();
+    length.clear();
+    afloat.clear();
+    Bitboard free = blocked.complement(nCells);
+    Bitboard none;
+    for (int i=0; i<game().nShips(); i++)
     {
-        b.block();
-        if (configExist(b, game().nShips()-1))
-        {
-            b.unblock();
-            return true;
-            break;
-        }
-        b.clear();
+        length.push_back(game().shipLength(i));
+        afloat.push_back(i);
+        addPlacements(huntDensity, free, none, length.back());
     }
-    if (configExist(b, game().nShips()-1))
-        return true;
-    return false;
 }
 
-Point GoodPlayer::recommendAttack()
+// add to density (or, if remove is set, take from it) every placement of a
+// ship of length len that lies on free cells and, if mustCover is not
+// empty, covers at least one of its cells; return whether there was any
+// such placement
+bool OptimalPlayer::addPlacements(BitboardCounter& density, const Bitboard& free, const Bitboard& mustCover, int len, bool remove) const
 {
-    Point p;
-    bool needRand = false;
     bool found = false;
-    
-    // in state 3, we keep going with a found direction until fail
-    // if failed (invalid point or attacked point), go back to state 2
-    if (state == 3)
+    for (int d=0; d<2; d++)
     {
-        if (direction <0 || direction >3)
-            needRand = true;
-        else
+        int step = (d == 0 ? 1 : game().cols());
+        Bitboard starts = (d == 0 ? hStarts[len] : vStarts[len]);
+        Bitboard covering;
+        for (int k=0; k<len; k++)
         {
-            needRand = false;
-            found = false;
-            while (true)
-            {
-                if (direction == 0)
-                    p = Point(lastHit.r, lastHit.c-1);
-                else if (direction == 1)
-                    p = Point(lastHit.r, lastHit.c+1);
-                else if (direction == 2)
-                    p = Point(lastHit.r-1, lastHit.c);
-                else if (direction == 3)
-                    p = Point(lastHit.r+1, lastHit.c);
-                
-                vector<double>::iterator iter = find (alreadyAttack.begin(), alreadyAttack.end(), p.r*game().cols() + p.c);
-                
-                if (!game().isValid(p))
-                    break;
-                            
-                else if (iter == alreadyAttack.end())
-                {
-                    alreadyAttack.push_back(p.r*game().cols() + p.c);
-                    found = true;
-                    break;
-                }
-                lastHit = p;
-            }
-            if (!found)
-            {
-                lastHit = firstHit;
-                state = 2;
-                direction = 0;
-            }
+            starts &= free >> (k*step);
+            covering |= mustCover >> (k*step);
+        }
+        if (mustCover.any())
+            starts &= covering;
+        if (starts.none())
+            continue;
+        
+        found = true;
+        for (int k=0; k<len; k++)
+        {
+            if (remove)
+                density.subtract(starts << (k*step));
+            else
+                density.add(starts << (k*step));
         }
     }
-    
-    // in state 2, we try each direction until we hit something in a direction
-    if (state == 2)
+    return found;
+}
+
+// set cells to the cells of a ship of length len starting at start, going
+// across if d is 0 and down if it is 1
+void OptimalPlayer::placement(int start, int len, int d, Bitboard& cells) const
+{
+    cells.clear();
+    if (masks.covers(len))
     {
-        found = false;
-        needRand = false;
-        for (int i=direction; i<4; i++)
+        cells.add(masks.mask(len, Direction(d), start), masks.nWords());
+        return;
+    }
+    int step = (d == 0 ? 1 : game().cols());
+    for (int k=0; k<len; k++)
+        cells.set(start + k*step);
+}
+
+// count the free cells in a row before cell (left or up) and after it
+// (right or down), going across if d is 0 and down if it is 1, up to one
+// less than the longest ship each way
+void OptimalPlayer::freeRun(int cell, int d, int& before, int& after) const
+{
+    int pos = (d == 0 ? cell % game().cols() : cell / game().cols());
+    int size = (d == 0 ? game().cols() : game().rows());
+    int step = (d == 0 ? 1 : game().cols());
+    before = 0;
+    while (before < maxLength-1 && pos-before-1 >= 0 && !blocked.test(cell - (before+1)*step))
+        before++;
+    after = 0;
+    while (after < maxLength-1 && pos+after+1 < size && !blocked.test(cell + (after+1)*step))
+        after++;
+}
+
+// cell is no longer free: take every placement of a ship afloat through it
+// out of huntDensity.  The placements of a ship of length len through cell
+// that lie on free cells are the ones starting k cells before it, for each
+// k that leaves room for the ship in the run of free cells around it.
+void OptimalPlayer::block(int cell)
+{
+    Bitboard cells;
+    for (int d=0; d<2; d++)
+    {
+        int step = (d == 0 ? 1 : game().cols());
+        int before, after;
+        freeRun(cell, d, before, after);
+        for (int i=0; i<(int)length.size(); i++)
         {
-            if (direction == 0)
-                p = Point(lastHit.r, lastHit.c-1);
-            else if (direction == 1)
-                p = Point(lastHit.r, lastHit.c+1);
-            else if (direction == 2)
-                p = Point(lastHit.r-1, lastHit.c);
-            else if (direction == 3)
-                p = Point(lastHit.r+1, lastHit.c);
-            
-            vector<double>::iterator iter = find (alreadyAttack.begin(), alreadyAttack.end(), p.r*game().cols() + p.c);
-                        
-            if (game().isValid(p) && iter == alreadyAttack.end())
+            int len = length[i];
+            for (int k=max(0, len-1-after); k<=min(before, len-1); k++)
             {
-                found = true;
-                alreadyAttack.push_back(p.r*game().cols() + p.c);
-                break;
+                placement(cell - k*step, len, d, cells);
+                huntDensity.subtract(cells);
             }
-            else
-            {
-                if(direction<3)
-                    direction ++;
-            }
-        }
-        
-        if(!found)
-        {
-            needRand = true;
-            state = 1;
         }
-        
     }
+    blocked.set(cell);
+}
+
+Point OptimalPlayer::recommendAttack()
+{
+    Bitboard candidates = shot.complement(nCells);
     
-    // in state 1 or we need random point, we will go through each spot on the board starting 0,0 and skipping smallest length-1 spots, first horizontally and vertically
-    if (state == 1 || needRand)
+    // target mode: only placements that explain the hits we have; each is
+    // counted at the first hit it covers
+    Bitboard hit = tracker.unexplained();
+    if (hit.any())
     {
-        if (rowIter < game().rows() && colIter < game().cols())
+        BitboardCounter density;
+        Bitboard done;
+        Bitboard cells;
+        bool found = false;
+        for (int h = hit.first(); h >= 0; h = hit.first())
         {
-            int min = *min_element(length.begin(), length.end());
-            for(; rowIter<game().rows(); rowIter++)
+            for (int d=0; d<2; d++)
             {
-                if (rowIter%2==0)
-                    colIter = 0;
-                else
-                    colIter=1;
-                
-                for (; colIter<game().cols(); colIter+=min)
+                int step = (d == 0 ? 1 : game().cols());
+                int before, after;
+                freeRun(h, d, before, after);
+                for (int i=0; i<(int)length.size(); i++)
                 {
-                    p = Point(rowIter, colIter);
-                    
-                    vector<double>::iterator iter = find (alreadyAttack.begin(), alreadyAttack.end(), p.r*game().cols() + p.c);
-                                
-                    if (iter == alreadyAttack.end())
+                    int len = length[i];
+                    for (int k=max(0, len-1-after); k<=min(before, len-1); k++)
                     {
-                        alreadyAttack.push_back(p.r*game().cols() + p.c);
-                        found = true;
-                        break;
+                        placement(h - k*step, len, d, cells);
+                        if (!cells.intersects(done))
+                        {
+                            density.add(cells);
+                            found = true;
+                        }
                     }
                 }
-                if (found)
-                    break;
             }
+            hit.reset(h);
+            done.set(h);
         }
-        else
+        Bitboard best = density.maxCells(candidates);
+        if (found && best.any())
         {
-            rowIter = colIter = 0;
-            int min = *min_element(length.begin(), length.end());
-            for(; colIter<game().cols(); colIter++)
-            {
-                if (colIter%2==0)
-                    rowIter = 0;
-                else
-                    rowIter=1;
-                
-                for (; rowIter<game().rows(); rowIter+=min)
-                {
-                    p = Point(rowIter, colIter);
-                    
-                    vector<double>::iterator iter = find (alreadyAttack.begin(), alreadyAttack.end(), p.r*game().cols() + p.c);
-                                
-                    if (iter == alreadyAttack.end())
-                    {
-                        alreadyAttack.push_back(p.r*game().cols() + p.c);
-                        found = true;
-                        break;
-                    }
-                }
-                if (found)
-                    break;
-            }
+            int cell = best.select(game().rng().randInt(best.count()));
+            return Point(cell / game().cols(), cell % game().cols());
         }
-        
-        // if we not found anything above, we will just find any point that is available
-        if (!found)
-        {
+    }
+    
+    // hunt mode, or no placement accounts for the hits
+    Bitboard best = huntDensity.maxCells(candidates);
+    if (best.none())
+        return Point();
+    int cell = best.select(game().rng().randInt(best.count()));
+    return Point(cell / game().cols(), cell % game().cols());
+}
 
-            for(int i=0; i<game().rows(); i++)
-            {
-                for (int j=0; j<game().cols(); j++)
-                {
-                    p = Point(i, j);
-                    
-                    vector<double>::iterator iter = find (alreadyAttack.begin(), alreadyAttack.end(), p.r*game().cols() + p.c);
-                                
-                    if (iter == alreadyAttack.end())
-                    {
-                        alreadyAttack.push_back(p.r*game().cols() + p.c);
-                        found = true;
-                        break;
-                    }
-                }
-                if (found)
-                    break;
-            }
-                
+void OptimalPlayer::recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId)
+{
+    if (!game().isValid(p))
+        return;
+    
+    int cell = cellOf(p);
+    shot.set(cell);
+    if (!validShot)
+        return;
+    
+    if (!shotHit)
+        tracker.recordMiss(p);
+    else if (!shipDestroyed)
+        tracker.recordHit(p);
+    else
+    {
+        // the sunk ship's placements go first, over the cells that were
+        // free until now
+        int len = game().shipLength(shipId);
+        GameVector<int>::iterator iter = find (length.begin(), length.end(), len);
+        if (iter != length.end())
+        {
+            length.erase(iter);
+            addPlacements(huntDensity, blocked.complement(nCells), Bitboard(), len, true);
         }
-        
+        GameVector<int>::iterator id = find (afloat.begin(), afloat.end(), shipId);
+        if (id != afloat.end())
+            afloat.erase(id);
+        tracker.recordSink(p, shipId);
     }
-    if (game().isValid(p))
+    
+    // a sink can settle earlier ones, so any number of cells may have
+    // stopped being free
+    Bitboard newlyBlocked = tracker.blocked();
+    newlyBlocked.subtract(blocked);
+    for (int c = newlyBlocked.first(); c >= 0; c = newlyBlocked.first())
     {
-        return p;
+        newlyBlocked.reset(c);
+        block(c);
     }
-    return Point();
 }
 
-void GoodPlayer::recordAttackByOpponent(Point p)
-{}
+//*********************************************************************
+//  MonteCarloPlayer
+//*********************************************************************
 
-// this function record the result of each attack
-void GoodPlayer::recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId)
+// MonteCarloPlayer keeps track of what it has learned the same way
+// OptimalPlayer does, but instead of counting placements ship by ship it
+// samples whole layouts of the ships still afloat that avoid every miss and
+// sunk cell and cover every unexplained hit, and fires at the unshot cell
+// occupied in the most samples.  The sampler places ships through the hits
+// first, so every sample is consistent with everything seen so far, and
+// the count isn't left to the few free draws that happen to cover the
+// hits.  If no layout covers them all, free draws are taken, and only
+// those covering the most hits are counted.
+//
+// Each move draws up to nSamples layouts, stopping early if budgetMicros
+// (if positive) runs out.  The layouts are drawn in SHARDS shards, each
+// with its own sampler, seed and tally, which a pool of nThreads threads
+// (kept for the player's lifetime) shares out; since the shards don't
+// depend on the threads, the player's moves don't either.
+class MonteCarloPlayer : public OptimalPlayer
 {
-    if (validShot)
+  public:
+    MonteCarloPlayer(string nm, const Game& g, int nSamples, int budgetMicros, int nThreads);
+    virtual string type() const { return "montecarlo"; }
+    virtual Point recommendAttack();
+  private:
+    static const int SHARDS = 8;
+    struct Tally
     {
-        if (shotHit)
+        BitboardCounter counter;
+        int covered;        // unexplained hits covered by the counted samples
+        int nSamples;
+    };
+    void sampleLayouts(FleetSampler& sampler, uint64_t seed, int n, chrono::steady_clock::time_point deadline, Tally& tally) const;
+    
+    int nSamples;
+    int budgetMicros;
+    vector<FleetSampler> samplers;  // one per shard
+    vector<Tally> tallies;          // one per shard
+    vector<uint64_t> seeds;         // one per shard, drawn afresh each move
+    ThreadPool pool;
+};
+
+MonteCarloPlayer::MonteCarloPlayer(string nm, const Game& g, int nSamples, int budgetMicros, int nThreads)
+ : OptimalPlayer(nm, g), nSamples(min(nSamples, BitboardCounter::MAXCOUNT)),
+   budgetMicros(budgetMicros), pool(nThreads)
+{
+    // the samplers grow on the sampling threads, so they can't share a
+    // per-game arena
+    GameArenaScope onHeap(nullptr);
+    for (int i=0; i<SHARDS; i++)
+    {
+        samplers.push_back(FleetSampler(g));
+        samplers.back().setMaxTries(1000);
+    }
+    tallies.resize(SHARDS);
+    seeds.resize(SHARDS);
+}
+
+void MonteCarloPlayer::sampleLayouts(FleetSampler& sampler, uint64_t seed, int n, chrono::steady_clock::time_point deadline, Tally& tally) const
+{
+    const int BATCH = 64;
+    Rng rng(seed);
+    Bitboard forbidden = tracker.blocked();
+    Bitboard hit = tracker.unexplained();
+    vector<Bitboard> layouts;
+    layouts.reserve(BATCH);
+    
+    tally.counter.clear();
+    tally.covered = -1;
+    tally.nSamples = 0;
+    sampler.setShips(afloat);
+    
+    // the layouts are drawn through the unexplained hits, unless the ships
+    // afloat can't cover them all (a ship taken for sunk in the wrong
+    // place, say); then they're drawn freely, and the ones covering the
+    // most hits are counted
+    bool covering = hit.any();
+    for (int done=0; done<n; done+=BATCH)
+    {
+        layouts.clear();
+        int got = 0;
+        if (covering)
         {
-            // if we hit something, record it on our fake board
-            fake_board[p.r][p.c] = 'X';
-            if (shipDestroyed)
-            {
-                state = 1;
-                vector<int>::iterator iter = find (length.begin(), length.end(), game().shipLength(shipId));
-                length.erase(iter);
-                
-                if(direction == 0)
-                {
-                    for (int i=0; i<game().shipLength(shipId); i++)
-                    {
-                        fake_board[p.r][p.c+i] = 'A';
-                    }
-                }
-                
-                if(direction == 1)
-                {
-                    for (int i=0; i<game().shipLength(shipId); i++)
-                    {
-                        fake_board[p.r][p.c-i] = 'A';
-                    }
-                }
-                if(direction == 2)
-                {
-                    for (int i=0; i<game().shipLength(shipId); i++)
-                    {
-                        fake_board[p.r+i][p.c] = 'A';
-                    }
-                }
-                if(direction == 3)
-                {
-                    for (int i=0; i<game().shipLength(shipId); i++)
-                    {
-                        fake_board[p.r-i][p.c] = 'A';
-                    }
-                }
-                
-                for (int i=0; i<MAXROWS; i++)
-                {
-                    for (int j=0; j<MAXCOLS; j++)
-                    {
-                        if (fake_board[i][j] == 'X')
-                        {
-                            firstHit = Point(i, j);
-                            lastHit = Point(i, j);
-                            state = 2;
-                        }
-                    }
-                }
-                
-                direction = 0;
-            }
-            
-            // hit but not destroyed
-            else if (state == 1)
-            {
-                firstHit = p;
-                lastHit = p;
-                state = 2;
-            }
-            
-            // hit and in state 2, switch to state 3
-            else if (state == 2)
+            got = sampler.sampleCovering(rng, min(BATCH, n-done), forbidden, hit, layouts);
+            covering = got > 0;
+        }
+        if (!covering)
+            got = sampler.sampleBatch(rng, min(BATCH, n-done), forbidden, layouts);
+        for (int i=0; i<got; i++)
+        {
+            int covered = layouts[i].countAnd(hit);
+            if (covered > tally.covered)
             {
-                lastHit = p;
-                state  = 3;
+                tally.counter.clear();
+                tally.covered = covered;
+                tally.nSamples = 0;
             }
-            
-            // hit and in state 3, stay in state 3
-            else if ( state == 3)
+            if (covered == tally.covered)
             {
-                lastHit = p;
+                tally.counter.add(layouts[i]);
+                tally.nSamples++;
             }
         }
-        
-        // state 2 but no hit, try next direction
-        else if (state == 2)
+        if (got < min(BATCH, n-done) || (budgetMicros > 0 && chrono::steady_clock::now() > deadline))
+            break;
+    }
+}
+
+Point MonteCarloPlayer::recommendAttack()
+{
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::microseconds(budgetMicros);
+    
+    // the seeds come from the game's generator, so a game still replays
+    // from its seed
+    long rejectedBefore = 0;
+    for (int i=0; i<SHARDS; i++)
+    {
+        rejectedBefore += samplers[i].rejections();
+        seeds[i] = game().rng().next();
+    }
+    pool.run(SHARDS, [this, deadline](int i) {
+        int n = nSamples/SHARDS + (i < nSamples%SHARDS ? 1 : 0);
+        sampleLayouts(samplers[i], seeds[i], n, deadline, tallies[i]);
+    });
+    long rejected = -rejectedBefore;
+    for (int i=0; i<SHARDS; i++)
+        rejected += samplers[i].rejections();
+    BS_COUNT(COUNTER_SAMPLE_REJECTIONS, rejected);
+    
+    // merge, in shard order, the tallies that explain the most hits; the
+    // counts can't pass MAXCOUNT, since they add up to at most nSamples
+    int covered = -1;
+    int first = -1;
+    for (int i=0; i<SHARDS; i++)
+    {
+        if (tallies[i].nSamples > 0 && tallies[i].covered > covered)
         {
-            direction++;
+            covered = tallies[i].covered;
+            first = i;
         }
-        // state 3 but not hit, go back to state 2
-        else if (state == 3)
+    }
+    if (first < 0)
+        return OptimalPlayer::recommendAttack();
+    for (int i=first+1; i<SHARDS; i++)
+        if (tallies[i].nSamples > 0 && tallies[i].covered == covered)
+            tallies[first].counter.add(tallies[i].counter);
+    
+    Bitboard best = tallies[first].counter.maxCells(shot.complement(nCells));
+    if (best.none())
+        return Point();
+    int cell = best.select(game().rng().randInt(best.count()));
+    return Point(cell / game().cols(), cell % game().cols());
+}
+
+//*********************************************************************
+//  AdaptivePlayer
+//*********************************************************************
+
+// AdaptivePlayer learns its opponent over a match of many games.  It counts,
+// for every cell, how often the opponent has fired there and how often it
+// has found one of the opponent's ships there, and keeps those counts when
+// it is reset for the next game.  It places its ships at random, but favors
+// cells the opponent has rarely fired at; it hunts on the cells where ships
+// have most often been found (on a checkerboard first, since a ship of two
+// or more cells always covers one of it), and after a hit tries the hit's
+// neighbors, the most often occupied first, until no hit is left
+// unexplained by a sunk ship.
+//
+// Each attack only adds one to a count, and the counts and all the per-game
+// state are sized once, when the player is made.
+class AdaptivePlayer : public Player
+{
+  public:
+    AdaptivePlayer(string nm, const Game& g);
+    virtual string type() const { return "adaptive"; }
+    virtual bool placeShips(Board& b);
+    virtual Point recommendAttack();
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+    virtual void reset();
+  private:
+    int cellOf(Point p) const { return p.r * game().cols() + p.c; }
+    void rankHunt();
+    Point huntTarget();
+    void pushNeighbors(Point p);
+
+    ShotTracker shots;
+    FleetSampler sampler;
+    GameVector<int> opponentShots;  // per cell: the opponent's attacks there, over the match
+    GameVector<int> shipsFound;     // per cell: our hits there, over the match
+    GameVector<double> weights;     // per cell: for placement, from opponentShots
+    GameVector<int> targets;        // cells next to unexplained hits, to try next
+    GameVector<uint64_t> huntOrder; // cells in the order to hunt them this game
+    size_t nextHunt;                // where the hunt has got to in huntOrder
+    bool ranked;                    // huntOrder is ready for this game
+    int games;                      // games finished against this opponent
+    static const int REWEIGH_GAMES = 16;
+    int unexplained;                // hits this game not yet accounted for by a sunk ship
+    bool played;                    // this game has had an attack, so counts as finished when reset
+};
+
+AdaptivePlayer::AdaptivePlayer(string nm, const Game& g)
+ : Player(nm, g), shots(g.rows(), g.cols()), sampler(g),
+   opponentShots(g.rows() * g.cols(), 0), shipsFound(g.rows() * g.cols(), 0),
+   weights(g.rows() * g.cols(), 1), huntOrder(g.rows() * g.cols()), games(0),
+   played(false)
+{
+      // each hit adds at most its four neighbors
+    targets.reserve(4 * g.rows() * g.cols());
+    AdaptivePlayer::reset();
+}
+
+// forget this game, but not what it taught us about the opponent
+void AdaptivePlayer::reset()
+{
+    if (played)
+        games++;
+    played = false;
+    shots.reset();
+    targets.clear();
+    ranked = false;
+    unexplained = 0;
+}
+
+bool AdaptivePlayer::placeShips(Board& b)
+{
+      // weigh each cell by how rarely the opponent has fired at it: a cell
+      // shot in every game weighs e^-3 times one never shot.  Reweighting
+      // means redoing every placement's weight, so once the counts have
+      // settled a little it is only done every REWEIGH_GAMES games.
+    if (games > 0  &&  (games < REWEIGH_GAMES  ||  games % REWEIGH_GAMES == 0))
+    {
+        for (size_t i = 0; i < weights.size(); i++)
+            weights[i] = exp(-3.0 * opponentShots[i] / games);
+        sampler.setWeights(weights);
+    }
+    return sampler.placeFleet(b, game().rng());
+}
+
+Point AdaptivePlayer::recommendAttack()
+{
+    played = true;
+    while (!targets.empty())
+    {
+        int cell = targets.back();
+        targets.pop_back();
+        Point p(cell / game().cols(), cell % game().cols());
+        if (!shots.isShot(p))
         {
-            state = 2;
-            lastHit = firstHit;
-            direction = 0;
+            shots.markShot(p);
+            return p;
         }
     }
+    if (shots.nUntried() == 0)
+        return Point();
+    Point p = huntTarget();
+    shots.markShot(p);
+    return p;
+}
+
+// Rank the cells for this game's hunt: the checkerboard first, and within
+// each half the cells where ships have been found most often first, ties
+// in random order.  Each cell's key packs those three things above its
+// number, so one sort does it, without allocating.
+void AdaptivePlayer::rankHunt()
+{
+    int cols = game().cols();
+    for (int cell = 0; cell < (int)huntOrder.size(); cell++)
+    {
+        uint64_t on = ((cell / cols + cell % cols) % 2 == 0);
+        uint64_t count = min(shipsFound[cell], (1 << 22) - 1);
+        uint64_t tie = game().rng().next() >> 51;
+        huntOrder[cell] = (on << 63) | (count << 41) | (tie << 28) | uint64_t(cell);
+    }
+    sort(huntOrder.begin(), huntOrder.end(), greater<uint64_t>());
+    nextHunt = 0;
+    ranked = true;
+}
+
+// the best-ranked cell not yet shot
+Point AdaptivePlayer::huntTarget()
+{
+    if (!ranked)
+        rankHunt();
+    int cols = game().cols();
+    while (nextHunt < huntOrder.size())
+    {
+        int cell = int(huntOrder[nextHunt++] & ((1 << 28) - 1));
+        Point p(cell / cols, cell % cols);
+        if (!shots.isShot(p))
+            return p;
+    }
+    return Point();
+}
+
+// queue p's unshot neighbors so the most promising is tried first
+void AdaptivePlayer::pushNeighbors(Point p)
+{
+    Point around[4] = {
+        Point(p.r-1, p.c), Point(p.r+1, p.c), Point(p.r, p.c-1), Point(p.r, p.c+1)
+    };
+    size_t first = targets.size();
+    for (int k = 0; k < 4; k++)
+    {
+        if (game().isValid(around[k])  &&  !shots.isShot(around[k]))
+            targets.push_back(cellOf(around[k]));
+    }
+      // the back of targets is tried first, so sort this group ascending
+    for (size_t i = first + 1; i < targets.size(); i++)
+    {
+        int cell = targets[i];
+        size_t j = i;
+        for ( ; j > first  &&  shipsFound[targets[j-1]] > shipsFound[cell]; j--)
+            targets[j] = targets[j-1];
+        targets[j] = cell;
+    }
+}
+
+void AdaptivePlayer::recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId)
+{
+    if (!validShot  ||  !shotHit)
+        return;
+    shipsFound[cellOf(p)]++;
+    unexplained++;
+    if (shipDestroyed)
+    {
+        unexplained -= game().shipLength(shipId);
+          // every hit is explained, so the cells queued around them are
+          // no more likely than any others
+        if (unexplained <= 0)
+        {
+            unexplained = 0;
+            targets.clear();
+            return;
+        }
+    }
+    pushNeighbors(p);
+}
+
+void AdaptivePlayer::recordAttackByOpponent(Point p)
+{
+    played = true;
+    if (game().isValid(p))
+        opponentShots[cellOf(p)]++;
 }
 
 //*********************************************************************
 //  createPlayer
 //*********************************************************************
 
+static const string playerTypes[] = {
+    "human", "awful", "mediocre", "good", "optimal", "montecarlo", "adaptive"
+};
+
+int nPlayerTypes()
+{
+    return sizeof(playerTypes)/sizeof(playerTypes[0]);
+}
+
+string playerType(int i)
+{
+    return playerTypes[i];
+}
+
 Player* createPlayer(string type, string nm, const Game& g)
 {
-    static string types[] = {
-        "human", "awful", "mediocre", "good"
-    };
-    
     int pos;
-    for (pos = 0; pos != sizeof(types)/sizeof(types[0])  &&
-                                                     type != types[pos]; pos++)
+    for (pos = 0; pos != nPlayerTypes()  &&  type != playerTypes[pos]; pos++)
         ;
     switch (pos)
     {
@@ -793,6 +1080,15 @@ Player* createPlayer(string type, string nm, const Game& g)
       case 1:  return new AwfulPlayer(nm, g);
       case 2:  return new MediocrePlayer(nm, g);
       case 3:  return new GoodPlayer(nm, g);
+      case 4:  return new OptimalPlayer(nm, g);
+      case 5:  return new MonteCarloPlayer(nm, g, 1000, 0, 1);
+      case 6:  return new AdaptivePlayer(nm, g);
       default: return nullptr;
     }
 }
+
+Player* createMonteCarloPlayer(string nm, const Game& g, int nSamples,
+                               int budgetMicros, int nThreads)
+{
+    return new MonteCarloPlayer(nm, g, nSamples, budgetMicros, nThreads);
+}
@@ -2,12 +2,14 @@
 #define PLAYER_INCLUDED
 
 #include <string>
+#include "Arena.h"
 
 class Point;
 class Board;
 class Game;
 
-class Player
+// Players made with new while a GameArenaScope is alive live in its arena
+class Player : public ArenaObject
 {
   public:
     Player(std::string nm, const Game& g)
@@ -20,12 +22,17 @@ class Player
     const Game& game() const { return m_game; }
 
     virtual bool isHuman() const { return false; }
+      // the name createPlayer knows this kind of player by
+    virtual std::string type() const = 0;
 
     virtual bool placeShips(Board& b) = 0;
     virtual Point recommendAttack() = 0;
     virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
                                         bool shipDestroyed, int shipId) = 0;
     virtual void recordAttackByOpponent(Point p) = 0;
+      // forget the last game, to play another on the same Game just as a
+      // newly created player would
+    virtual void reset() = 0;
       // We prevent any kind of Player object from being copied or assigned
     Player(const Player&) = delete;
     Player& operator=(const Player&) = delete;
@@ -37,4 +44,17 @@ class Player
 
 Player* createPlayer(std::string type, std::string nm, const Game& g);
 
+  // A "montecarlo" player with its sampling budget set: each move draws up
+  // to nSamples layouts (at most BitboardCounter::MAXCOUNT) over nThreads
+  // threads (0 means one per hardware thread), and stops early once
+  // budgetMicros microseconds have passed (if budgetMicros > 0).  The
+  // "montecarlo" type draws 1000 layouts on the calling thread alone, so
+  // it can be made freely from threads that already run in parallel.
+Player* createMonteCarloPlayer(std::string nm, const Game& g, int nSamples,
+                               int budgetMicros, int nThreads);
+
+  // The type names createPlayer accepts, numbered 0 to nPlayerTypes()-1
+int nPlayerTypes();
+std::string playerType(int i);
+
 #endif // PLAYER_INCLUDED
@@ -0,0 +1,564 @@
+#include "Replay.h"
+#include "GameRecord.h"
+#include "Game.h"
+#include "Board.h"
+#include "Player.h"
+#include "globals.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//******************** RecordFile *************************************
+
+RecordFile::RecordFile(const string& path)
+ : m_data(nullptr), m_size(0), m_mapped(false), m_damaged(false)
+{
+#ifdef _WIN32
+      // no mapping here; read the whole file instead
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in)
+        return;
+    m_size = (size_t)in.tellg();
+    char* data = new char[m_size + 1];
+    in.seekg(0);
+    if (!in.read(data, m_size))
+    {
+        delete [] data;
+        return;
+    }
+    m_data = data;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0  &&  st.st_size > 0)
+    {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            m_data = static_cast<const char*>(p);
+            m_size = st.st_size;
+            m_mapped = true;
+        }
+    }
+    close(fd);
+    if (m_data == nullptr)
+        return;
+#endif
+
+    const char* end = m_data + m_size;
+    int headerSize = recordFileHeaderSize(m_data, end);
+    if (headerSize == 0)
+    {
+        m_damaged = true;
+        return;
+    }
+
+      // only the chunk headers are read here; the records stay untouched
+      // until a scan asks for them
+    const char* p = m_data + headerSize;
+    while (p != end)
+    {
+        ChunkHeader h;
+        if (!readChunkHeader(p, end, h)  ||
+            h.nBytes > size_t(end - p - ChunkHeader::SIZE))
+        {
+            m_damaged = true;
+            break;
+        }
+        Chunk c;
+        c.begin = p + ChunkHeader::SIZE;
+        c.end = c.begin + h.nBytes;
+        c.nRecords = (int)h.nRecords;
+        c.checksum = h.checksum;
+        m_chunks.push_back(c);
+        p = c.end;
+    }
+}
+
+RecordFile::~RecordFile()
+{
+    if (m_data == nullptr)
+        return;
+#ifdef _WIN32
+    delete [] m_data;
+#else
+    if (m_mapped)
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+long RecordFile::nRecords() const
+{
+    long n = 0;
+    for (size_t i = 0; i < m_chunks.size(); i++)
+        n += m_chunks[i].nRecords;
+    return n;
+}
+
+bool RecordFile::intact(const Chunk& c) const
+{
+    return recordChecksum(c.begin, c.end) == c.checksum;
+}
+
+bool RecordFile::firstRecord(GameRecord& r) const
+{
+    for (size_t i = 0; i < m_chunks.size(); i++)
+    {
+        if (m_chunks[i].nRecords == 0  ||  !intact(m_chunks[i]))
+            continue;
+        GameRecordDecoder decoder(m_chunks[i].begin, m_chunks[i].end);
+        return decoder.next(r);
+    }
+    return false;
+}
+
+// Hand out the chunks of a file to nThreads threads, each calling
+// scan(chunk, threadIndex) for every chunk it takes.  Chunks are taken one
+// at a time from a shared counter, so a thread that gets small chunks
+// simply takes more of them.
+template <typename Scan>
+static void scanChunks(const RecordFile& file, int nThreads, Scan scan)
+{
+    if (nThreads <= 0)
+        nThreads = max(1, (int)thread::hardware_concurrency());
+    nThreads = max(1, min(nThreads, (int)file.chunks().size()));
+
+    atomic<size_t> next(0);
+    auto work = [&file, &next, &scan](int self) {
+        for (size_t i = next++; i < file.chunks().size(); i = next++)
+            scan(file.chunks()[i], self);
+    };
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(thread(work, t));
+    work(0);
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+}
+
+//******************** ReplayStats ************************************
+
+ReplayStats::ReplayStats(int nRows, int nCols)
+ : rows(nRows), cols(nCols), games(0), skipped(0), damagedChunks(0),
+   attacks(0), wastedAttacks(0), attacksAt(nRows*nCols, 0),
+   hitsAt(nRows*nCols, 0), shipsAt(nRows*nCols, 0), firstHits(0),
+   shotsToFirstHit(0)
+{
+}
+
+// whether every ship in the record's placements, and every valid shot,
+// lies on its board; a record can pass its checksum and still have been
+// written wrongly
+static bool fitsBoard(const GameRecord& r)
+{
+    for (int side = 0; side < 2; side++)
+    {
+        const vector<ShipPlacement>& fleet = r.placements[side];
+        if (fleet.size() > r.ships.size())
+            return false;
+        for (size_t s = 0; s < fleet.size(); s++)
+        {
+            Point p = fleet[s].topOrLeft;
+            int len = r.ships[s].length;
+            int lastR = (fleet[s].dir == HORIZONTAL ? p.r : p.r + len - 1);
+            int lastC = (fleet[s].dir == HORIZONTAL ? p.c + len - 1 : p.c);
+            if (len < 1  ||  p.r < 0  ||  p.c < 0  ||  lastR >= r.rows  ||  lastC >= r.cols)
+                return false;
+        }
+    }
+    for (size_t k = 0; k < r.shots.size(); k++)
+    {
+        Point p = r.shots[k].p;
+        if (r.shots[k].validShot  &&
+            (p.r < 0  ||  p.r >= r.rows  ||  p.c < 0  ||  p.c >= r.cols))
+            return false;
+    }
+    return true;
+}
+
+void ReplayStats::add(const GameRecord& r)
+{
+    if (r.rows != rows  ||  r.cols != cols  ||  !fitsBoard(r))
+    {
+        skipped++;
+        return;
+    }
+    games++;
+
+    int maxLength = 0;
+    for (size_t s = 0; s < r.ships.size(); s++)
+        maxLength = max(maxLength, r.ships[s].length);
+    if ((int)sinks.size() <= maxLength)
+    {
+        sinks.resize(maxLength+1, 0);
+        shotsPerSink.resize(maxLength+1, 0);
+    }
+
+    for (int side = 0; side < 2; side++)
+    {
+        const vector<ShipPlacement>& fleet = r.placements[side];
+        for (size_t s = 0; s < fleet.size(); s++)
+        {
+            int cell = fleet[s].topOrLeft.r * cols + fleet[s].topOrLeft.c;
+            int step = (fleet[s].dir == HORIZONTAL ? 1 : cols);
+            for (int k = 0; k < r.ships[s].length; k++, cell += step)
+                shipsAt[cell]++;
+        }
+    }
+
+      // player 1 makes the even-numbered attacks, at player 2's fleet
+    vector<int> firstHitOnShip[2];
+    firstHitOnShip[0].assign(r.ships.size(), 0);
+    firstHitOnShip[1].assign(r.ships.size(), 0);
+    int attacksBy[2] = { 0, 0 };
+    bool hitYet[2] = { false, false };
+    for (size_t k = 0; k < r.shots.size(); k++)
+    {
+        const ShotRecord& shot = r.shots[k];
+        int side = k % 2;
+        int n = ++attacksBy[side];
+        attacks++;
+        if (!shot.validShot)
+        {
+            wastedAttacks++;
+            continue;
+        }
+        int cell = shot.p.r * cols + shot.p.c;
+        attacksAt[cell]++;
+        if (!shot.shotHit)
+            continue;
+        hitsAt[cell]++;
+        if (!hitYet[side])
+        {
+            hitYet[side] = true;
+            firstHits++;
+            shotsToFirstHit += n;
+        }
+
+          // which ship was hit isn't recorded until it sinks, so find it
+          // from the defender's placements
+        const vector<ShipPlacement>& fleet = r.placements[1-side];
+        for (size_t s = 0; s < fleet.size(); s++)
+        {
+            int len = r.ships[s].length;
+            Point p = fleet[s].topOrLeft;
+            bool covers = (fleet[s].dir == HORIZONTAL ?
+                           shot.p.r == p.r  &&  shot.p.c >= p.c  &&  shot.p.c < p.c + len :
+                           shot.p.c == p.c  &&  shot.p.r >= p.r  &&  shot.p.r < p.r + len);
+            if (covers  &&  firstHitOnShip[side][s] == 0)
+                firstHitOnShip[side][s] = n;
+        }
+        if (shot.shipDestroyed  &&  shot.shipId >= 0  &&
+            shot.shipId < (int)r.ships.size())
+        {
+            int len = r.ships[shot.shipId].length;
+            sinks[len]++;
+            shotsPerSink[len] += n - firstHitOnShip[side][shot.shipId] + 1;
+        }
+    }
+}
+
+void ReplayStats::add(const ReplayStats& other)
+{
+    games += other.games;
+    skipped += other.skipped;
+    damagedChunks += other.damagedChunks;
+    attacks += other.attacks;
+    wastedAttacks += other.wastedAttacks;
+    for (size_t i = 0; i < attacksAt.size()  &&  i < other.attacksAt.size(); i++)
+    {
+        attacksAt[i] += other.attacksAt[i];
+        hitsAt[i] += other.hitsAt[i];
+        shipsAt[i] += other.shipsAt[i];
+    }
+    firstHits += other.firstHits;
+    shotsToFirstHit += other.shotsToFirstHit;
+    if (sinks.size() < other.sinks.size())
+    {
+        sinks.resize(other.sinks.size(), 0);
+        shotsPerSink.resize(other.sinks.size(), 0);
+    }
+    for (size_t len = 0; len < other.sinks.size(); len++)
+    {
+        sinks[len] += other.sinks[len];
+        shotsPerSink[len] += other.shotsPerSink[len];
+    }
+}
+
+ReplayStats analyzeRecords(const RecordFile& file, int rows, int cols,
+                           int nThreads)
+{
+    if (nThreads <= 0)
+        nThreads = max(1, (int)thread::hardware_concurrency());
+    vector<ReplayStats> partial(nThreads, ReplayStats(rows, cols));
+    scanChunks(file, nThreads, [&file, &partial](const RecordFile::Chunk& c, int self) {
+        ReplayStats& stats = partial[self];
+        if (!file.intact(c))
+        {
+            stats.damagedChunks++;
+            return;
+        }
+        GameRecordDecoder decoder(c.begin, c.end);
+        GameRecord r;
+        for (int i = 0; i < c.nRecords  &&  decoder.next(r); i++)
+            stats.add(r);
+    });
+
+    ReplayStats total(rows, cols);
+    for (size_t t = 0; t < partial.size(); t++)
+        total.add(partial[t]);
+    return total;
+}
+
+// print a per-cell count as a whole number per 100 fleets
+static void printMap(const char* title, const vector<long>& counts,
+                     const ReplayStats& stats, ostream& out)
+{
+    out << title << " (per 100 fleets):" << endl;
+    long fleets = 2 * stats.games;
+    for (int r = 0; r < stats.rows; r++)
+    {
+        out << " ";
+        for (int c = 0; c < stats.cols; c++)
+            out << setw(4) << (fleets == 0 ? 0 : (100 * counts[r*stats.cols + c] + fleets/2) / fleets);
+        out << endl;
+    }
+}
+
+void printReplayStats(const ReplayStats& stats, ostream& out)
+{
+    out << stats.games << " games on a " << stats.rows << " x " << stats.cols
+        << " board";
+    if (stats.skipped > 0)
+        out << " (" << stats.skipped << " games of other sizes or going off the board skipped)";
+    if (stats.damagedChunks > 0)
+        out << " (" << stats.damagedChunks << " damaged chunks skipped)";
+    out << endl;
+    if (stats.games == 0)
+        return;
+
+    out << fixed << setprecision(2);
+    out << "attacks per fleet: " << stats.attacks / (2.0 * stats.games)
+        << ", wasted: " << stats.wastedAttacks / (2.0 * stats.games) << endl;
+    if (stats.firstHits > 0)
+        out << "attacks to first hit: "
+            << double(stats.shotsToFirstHit) / stats.firstHits << endl;
+    for (size_t len = 0; len < stats.sinks.size(); len++)
+    {
+        if (stats.sinks[len] > 0)
+            out << "length " << len << ": " << stats.sinks[len]
+                << " sunk, attacks from first hit to sinking "
+                << double(stats.shotsPerSink[len]) / stats.sinks[len] << endl;
+    }
+
+      // maps of big boards would just scroll away
+    if (stats.cols > 40)
+        return;
+    printMap("attacks", stats.attacksAt, stats, out);
+    printMap("hits", stats.hitsAt, stats, out);
+    printMap("ship placements", stats.shipsAt, stats, out);
+}
+
+//******************** Replaying against recorded fleets **************
+
+ReplayAttacker::ReplayAttacker(const string& type)
+ : m_type(type), m_game(nullptr), m_board(nullptr), m_player(nullptr)
+{
+}
+
+ReplayAttacker::~ReplayAttacker()
+{
+    tearDown();
+}
+
+void ReplayAttacker::tearDown()
+{
+    delete m_player;
+    delete m_board;
+    delete m_game;
+    m_player = nullptr;
+    m_board = nullptr;
+    m_game = nullptr;
+}
+
+// make the game, board and player for r's board size and ships, unless
+// the ones we have already suit it
+bool ReplayAttacker::setUp(const GameRecord& r)
+{
+    if (m_game != nullptr  &&  sameSetup(r, m_setup))
+        return m_player != nullptr;
+    tearDown();
+    m_setup.rows = r.rows;
+    m_setup.cols = r.cols;
+    m_setup.ships = r.ships;
+    m_game = new Game(r.rows, r.cols);
+    for (size_t s = 0; s < r.ships.size(); s++)
+        if (!m_game->addShip(r.ships[s].length, r.ships[s].symbol, r.ships[s].name))
+            return false;
+    m_board = new Board(*m_game);
+    m_player = createPlayer(m_type, m_type, *m_game);
+    return m_player != nullptr;
+}
+
+int ReplayAttacker::attack(const GameRecord& r, int side, int maxAttacks)
+{
+    if (!setUp(r))
+        return -1;
+    const vector<ShipPlacement>& fleet = r.placements[side];
+    if ((int)fleet.size() != m_game->nShips())
+        return -1;
+    m_board->clear();
+    for (int s = 0; s < m_game->nShips(); s++)
+        if (!m_board->placeShip(fleet[s].topOrLeft, s, fleet[s].dir))
+            return -1;
+
+    m_game->seed(r.seed);
+    m_player->reset();
+    if (maxAttacks <= 0)
+        maxAttacks = 4 * r.rows * r.cols;
+    int n = 0;
+    while (!m_board->allShipsDestroyed()  &&  n < maxAttacks)
+    {
+        Point attack = m_player->recommendAttack();
+        ShotResult shot = m_board->attack(attack);
+        m_player->recordAttackResult(attack, shot.valid, shot.hit, shot.destroyed, shot.shipId);
+        n++;
+    }
+    return m_board->allShipsDestroyed() ? n : -1;
+}
+
+int replayAttack(const string& type, const GameRecord& r, int side, int maxAttacks)
+{
+    ReplayAttacker attacker(type);
+    return attacker.attack(r, side, maxAttacks);
+}
+
+// running totals for evaluateOnRecords
+struct EvaluationTally
+{
+    EvaluationTally() : fleets(0), failed(0), attacks(0), compared(0),
+                        better(0), worse(0), recordedAttacks(0) {}
+    long fleets;
+    long failed;
+    long attacks;
+    long compared;
+    long better;
+    long worse;
+    long recordedAttacks;
+};
+
+ReplayEvaluation evaluateOnRecords(const RecordFile& file, const string& type,
+                                   int rows, int cols, int nThreads)
+{
+    ReplayEvaluation e;
+    e.type = type;
+    e.fleets = e.failed = e.compared = e.better = e.worse = 0;
+    e.meanAttacks = e.meanRecordedAttacks = 0;
+
+      // a human would have to play every fleet by hand
+    {
+        Game g(rows, cols);
+        Player* p = createPlayer(type, type, g);
+        bool usable = (p != nullptr  &&  !p->isHuman());
+        delete p;
+        if (!usable)
+            return e;
+    }
+
+    if (nThreads <= 0)
+        nThreads = max(1, (int)thread::hardware_concurrency());
+    vector<EvaluationTally> partial(nThreads);
+    vector<ReplayAttacker*> attackers(nThreads, nullptr);
+    scanChunks(file, nThreads, [&](const RecordFile::Chunk& c, int self) {
+        EvaluationTally& t = partial[self];
+        if (attackers[self] == nullptr)
+            attackers[self] = new ReplayAttacker(type);
+        if (!file.intact(c))
+            return;
+        GameRecordDecoder decoder(c.begin, c.end);
+        GameRecord r;
+        for (int i = 0; i < c.nRecords  &&  decoder.next(r); i++)
+        {
+            if (r.rows != rows  ||  r.cols != cols  ||  !fitsBoard(r))
+                continue;
+            for (int side = 0; side < 2; side++)
+            {
+                t.fleets++;
+                int n = attackers[self]->attack(r, side);
+                if (n < 0)
+                {
+                    t.failed++;
+                    continue;
+                }
+                t.attacks += n;
+
+                  // the recorded attacker sank this fleet only if it won
+                int attacker = 1 - side;
+                if (r.winner != attacker + 1)
+                    continue;
+                int recorded = (int)(r.shots.size() + 1 - attacker) / 2;
+                t.compared++;
+                t.recordedAttacks += recorded;
+                if (n < recorded)
+                    t.better++;
+                else if (n > recorded)
+                    t.worse++;
+            }
+        }
+    });
+    for (size_t i = 0; i < attackers.size(); i++)
+        delete attackers[i];
+
+    EvaluationTally total;
+    for (size_t i = 0; i < partial.size(); i++)
+    {
+        total.fleets += partial[i].fleets;
+        total.failed += partial[i].failed;
+        total.attacks += partial[i].attacks;
+        total.compared += partial[i].compared;
+        total.better += partial[i].better;
+        total.worse += partial[i].worse;
+        total.recordedAttacks += partial[i].recordedAttacks;
+    }
+    e.fleets = total.fleets;
+    e.failed = total.failed;
+    e.compared = total.compared;
+    e.better = total.better;
+    e.worse = total.worse;
+    if (total.fleets > total.failed)
+        e.meanAttacks = double(total.attacks) / (total.fleets - total.failed);
+    if (total.compared > 0)
+        e.meanRecordedAttacks = double(total.recordedAttacks) / total.compared;
+    return e;
+}
+
+void printReplayEvaluation(const ReplayEvaluation& e, ostream& out)
+{
+    out << e.type << " attacked " << e.fleets << " recorded fleets";
+    if (e.failed > 0)
+        out << " (" << e.failed << " not sunk)";
+    out << endl;
+    out << fixed << setprecision(2)
+        << "  mean attacks to sink a fleet: " << e.meanAttacks << endl;
+    if (e.compared > 0)
+        out << "  against the " << e.compared
+            << " fleets the recorded attacker sank (mean "
+            << e.meanRecordedAttacks << " attacks): " << e.better
+            << " sunk faster, " << e.worse << " slower" << endl;
+}
@@ -0,0 +1,140 @@
+#ifndef REPLAY_INCLUDED
+#define REPLAY_INCLUDED
+
+#include "GameRecord.h"
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+
+class Game;
+class Board;
+class Player;
+
+// A record file mapped into memory, split into its chunks.  Nothing is
+// decoded until a chunk is asked for, so opening even a huge file is cheap.
+class RecordFile
+{
+  public:
+    struct Chunk
+    {
+        const char* begin;
+        const char* end;
+        int nRecords;
+        uint32_t checksum;
+    };
+
+    RecordFile(const std::string& path);
+    ~RecordFile();
+    bool isOpen() const { return m_data != nullptr; }
+      // whether the file ends in a damaged or incomplete chunk (the chunks
+      // before it are still usable)
+    bool damaged() const { return m_damaged; }
+    const std::vector<Chunk>& chunks() const { return m_chunks; }
+    long nRecords() const;
+      // whether a chunk's records match its checksum; this reads the whole
+      // chunk, so it's left to whoever scans it
+    bool intact(const Chunk& c) const;
+      // decode the file's first record; return false if it has none
+    bool firstRecord(GameRecord& r) const;
+      // We prevent a RecordFile object from being copied or assigned
+    RecordFile(const RecordFile&) = delete;
+    RecordFile& operator=(const RecordFile&) = delete;
+
+  private:
+    const char* m_data;
+    size_t m_size;
+    bool m_mapped;          // m_data is a mapping rather than a heap copy
+    bool m_damaged;
+    std::vector<Chunk> m_chunks;
+};
+
+// Totals over a set of recorded games of one board size.  Per-cell counts
+// are in row-major order, and "attacks" counts attacks made by both
+// players against each other's fleets.
+struct ReplayStats
+{
+    ReplayStats(int nRows = 0, int nCols = 0);
+    void add(const GameRecord& r);
+    void add(const ReplayStats& other);
+
+    int rows;
+    int cols;
+    long games;
+    long skipped;                       // games of another board size, or
+                                        //   with a ship or shot off it
+    long damagedChunks;                 // chunks left out for a bad checksum
+    long attacks;
+    long wastedAttacks;
+    std::vector<long> attacksAt;        // per cell: attacks there
+    std::vector<long> hitsAt;           // per cell: attacks that hit
+    std::vector<long> shipsAt;          // per cell: fleets with a ship there
+    long firstHits;                     // fleets that were hit at all
+    long shotsToFirstHit;               // total over those fleets
+    std::vector<long> sinks;            // per ship length: ships sunk
+    std::vector<long> shotsPerSink;     // per ship length: total attacks
+                                        //   from first hit to sinking
+};
+
+  // Scan every record of the file on nThreads threads (0 means one per
+  // hardware thread), counting games of the given board size
+ReplayStats analyzeRecords(const RecordFile& file, int rows, int cols,
+                           int nThreads = 0);
+
+void printReplayStats(const ReplayStats& stats, std::ostream& out);
+
+// Lets a player of one type attack recorded fleets.  The game, board and
+// player are kept from one fleet to the next and only made again when the
+// board size or ships change; between fleets the game is reseeded and the
+// player reset, so each attack goes as it would for a fresh player.
+class ReplayAttacker
+{
+  public:
+    ReplayAttacker(const std::string& type);
+    ~ReplayAttacker();
+      // attack one recorded fleet (side 0 or 1) and return the attacks
+      // needed to sink every ship, or -1 if that took more than maxAttacks
+      // (0 means 4 times the cells)
+    int attack(const GameRecord& r, int side, int maxAttacks = 0);
+      // We prevent a ReplayAttacker object from being copied or assigned
+    ReplayAttacker(const ReplayAttacker&) = delete;
+    ReplayAttacker& operator=(const ReplayAttacker&) = delete;
+
+  private:
+    bool setUp(const GameRecord& r);
+    void tearDown();
+
+    std::string m_type;
+    Game* m_game;
+    Board* m_board;
+    Player* m_player;
+    GameRecord m_setup;     // board size and ships of m_game
+};
+
+  // Let a fresh player of the given type attack one recorded fleet, as
+  // ReplayAttacker::attack does
+int replayAttack(const std::string& type, const GameRecord& r, int side,
+                 int maxAttacks = 0);
+
+// How a player type does against the fleets of a record file, compared to
+// the players who actually attacked them
+struct ReplayEvaluation
+{
+    std::string type;
+    long fleets;                // fleets attacked
+    long failed;                // fleets the player didn't sink
+    double meanAttacks;         // over the fleets it sank
+    long compared;              // fleets the recorded attacker also sank
+    long better;                // of those, fleets sunk in fewer attacks
+    long worse;                 //   or in more
+    double meanRecordedAttacks; // the recorded attackers' mean over those
+};
+
+  // Replay every recorded fleet (of the given board size) against a new
+  // player of the given type, on nThreads threads
+ReplayEvaluation evaluateOnRecords(const RecordFile& file, const std::string& type,
+                                   int rows, int cols, int nThreads = 0);
+
+void printReplayEvaluation(const ReplayEvaluation& e, std::ostream& out);
+
+#endif // REPLAY_INCLUDED
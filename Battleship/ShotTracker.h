@@ -0,0 +1,75 @@
+#ifndef SHOTTRACKER_INCLUDED
+#define SHOTTRACKER_INCLUDED
+
+#include "globals.h"
+#include "Bitboard.h"
+#include "Arena.h"
+#include <vector>
+
+// Keeps track of which cells a player has already fired at.  Asking whether
+// a cell has been shot, marking a cell shot, and picking a random cell that
+// hasn't been shot yet all take constant time: the unshot cells are kept in
+// an array in no particular order, and marking a cell moves the last entry
+// into its slot.
+class ShotTracker
+{
+  public:
+    ShotTracker(int nRows, int nCols)
+     : m_cols(nCols), m_untried(nRows * nCols), m_pos(nRows * nCols)
+    {
+        reset();
+    }
+
+      // forget every shot
+    void reset()
+    {
+        m_shot.clear();
+        for (int i = 0; i < (int)m_untried.size(); i++)
+        {
+            m_untried[i] = i;
+            m_pos[i] = i;
+        }
+        m_nUntried = (int)m_untried.size();
+    }
+
+      // p must be on the board
+    bool isShot(Point p) const { return m_shot.test(cellOf(p)); }
+
+      // p must be on the board; marking a cell twice is harmless
+    void markShot(Point p)
+    {
+        int cell = cellOf(p);
+        if (m_shot.test(cell))
+            return;
+        m_shot.set(cell);
+        int last = m_untried[--m_nUntried];
+        m_untried[m_pos[cell]] = last;
+        m_pos[last] = m_pos[cell];
+    }
+
+    int nUntried() const { return m_nUntried; }
+
+      // the cell number (row*cols+col) of the i-th cell that hasn't been
+      // shot, for i from 0 to nUntried()-1, in no particular order
+    int untried(int i) const { return m_untried[i]; }
+
+      // a cell that hasn't been shot, chosen uniformly; there must be one
+    Point randomUntried(Rng& rng) const
+    {
+        int cell = m_untried[rng.randInt(m_nUntried)];
+        return Point(cell / m_cols, cell % m_cols);
+    }
+
+    const Bitboard& shots() const { return m_shot; }
+
+  private:
+    int cellOf(Point p) const { return p.r * m_cols + p.c; }
+
+    int m_cols;
+    Bitboard m_shot;
+    GameVector<int> m_untried;   // the first m_nUntried entries are unshot cells
+    GameVector<int> m_pos;       // where each unshot cell is in m_untried
+    int m_nUntried;
+};
+
+#endif // SHOTTRACKER_INCLUDED
@@ -0,0 +1,264 @@
+#include "SimulationStats.h"
+#include "Game.h"
+#include "Player.h"
+#include "globals.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+//******************** CounterBlock functions ***********************
+
+CounterBlock::CounterBlock(size_t n)
+ : m_lines(new Line[(n + PER_LINE - 1) / PER_LINE]), m_size(n)
+{
+    for (size_t i = 0; i < (n + PER_LINE - 1) / PER_LINE; i++)
+        for (size_t k = 0; k < PER_LINE; k++)
+            m_lines[i].n[k].store(0, memory_order_relaxed);
+}
+
+//******************** SimulationStats functions ********************
+
+// every attack either sinks a ship or uses up a cell, so a game without
+// wasted shots takes at most two boards' worth of turns, and a ship is
+// sunk within one board's worth of its attacker's attacks
+SimulationStats::SimulationStats(const Game& g, const vector<string>& players, int nShards)
+ : m_rows(g.rows()), m_cols(g.cols()), m_players(players),
+   m_maxTurns(2 * g.rows() * g.cols())
+{
+    for (int s = 0; s < g.nShips(); s++)
+        m_shipNames.push_back(g.shipName(s));
+    int cells = m_rows * m_cols;
+    m_perPlayer = NSCALARS + (m_maxTurns + 1) + m_shipNames.size() * (cells + 1) + cells;
+    if (nShards <= 0)
+        nShards = max(1, (int)thread::hardware_concurrency());
+    for (int i = 0; i < nShards; i++)
+        m_shards.push_back(unique_ptr<Shard>(new Shard(*this)));
+}
+
+size_t SimulationStats::winLengthAt(int player, int turns) const
+{
+    return base(player) + NSCALARS + min(turns, m_maxTurns);
+}
+
+size_t SimulationStats::sinkTurnAt(int player, int shipId, int turn) const
+{
+    int cells = m_rows * m_cols;
+    return base(player) + NSCALARS + (m_maxTurns + 1) +
+           shipId * (cells + 1) + min(turn, cells);
+}
+
+size_t SimulationStats::hitAt(int player, Point p) const
+{
+    int cells = m_rows * m_cols;
+    return base(player) + NSCALARS + (m_maxTurns + 1) +
+           m_shipNames.size() * (cells + 1) + p.r * m_cols + p.c;
+}
+
+int SimulationStats::playerIndex(const string& name) const
+{
+    for (size_t i = 0; i < m_players.size(); i++)
+        if (m_players[i] == name)
+            return (int)i;
+    return -1;
+}
+
+// a shard may still be counting while this runs, so a summary taken
+// mid-game can be a few events behind, but never inconsistent enough to
+// matter for a progress report
+SimulationSummary SimulationStats::summary() const
+{
+    SimulationSummary s;
+    s.rows = m_rows;
+    s.cols = m_cols;
+    s.shipNames = m_shipNames;
+    int cells = m_rows * m_cols;
+    for (int p = 0; p < (int)m_players.size(); p++)
+    {
+        PlayerSimulationStats ps;
+        ps.name = m_players[p];
+        ps.games = ps.wins = ps.attacks = ps.hits = ps.wasted = 0;
+        ps.winLength.assign(m_maxTurns + 1, 0);
+        ps.sinkTurn.assign(m_shipNames.size(), vector<uint64_t>(cells + 1, 0));
+        ps.hitsAt.assign(cells, 0);
+        for (size_t k = 0; k < m_shards.size(); k++)
+        {
+            const CounterBlock& c = m_shards[k]->m_counts;
+            ps.games += c.get(base(p) + GAMES);
+            ps.wins += c.get(base(p) + WINS);
+            ps.attacks += c.get(base(p) + ATTACKS);
+            ps.hits += c.get(base(p) + HITS);
+            ps.wasted += c.get(base(p) + WASTED);
+            for (int t = 0; t <= m_maxTurns; t++)
+                ps.winLength[t] += c.get(winLengthAt(p, t));
+            for (size_t ship = 0; ship < m_shipNames.size(); ship++)
+                for (int t = 0; t <= cells; t++)
+                    ps.sinkTurn[ship][t] += c.get(sinkTurnAt(p, (int)ship, t));
+            for (int r = 0; r < m_rows; r++)
+                for (int col = 0; col < m_cols; col++)
+                    ps.hitsAt[r*m_cols + col] += c.get(hitAt(p, Point(r, col)));
+        }
+        s.players.push_back(ps);
+    }
+    return s;
+}
+
+//******************** Shard functions ******************************
+
+SimulationStats::Shard::Shard(const SimulationStats& owner)
+ : m_owner(owner), m_counts(owner.m_players.size() * owner.m_perPlayer)
+{
+    m_player[0] = m_player[1] = -1;
+    m_attacks[0] = m_attacks[1] = 0;
+}
+
+void SimulationStats::Shard::onPlacement(int player, const Player& p, const Board& /* b */)
+{
+    const Game& g = p.game();
+    bool sameSetup = (g.rows() == m_owner.m_rows  &&  g.cols() == m_owner.m_cols  &&
+                      g.nShips() == (int)m_owner.m_shipNames.size());
+    m_player[player] = (sameSetup ? m_owner.playerIndex(p.name()) : -1);
+    m_attacks[player] = 0;
+    if (m_player[player] >= 0)
+        m_counts.add(m_owner.base(m_player[player]) + GAMES);
+}
+
+void SimulationStats::Shard::onAttack(int player, const Player& /* attacker */, Point p,
+                                      bool validShot, bool shotHit, bool /* shipDestroyed */,
+                                      int /* shipId */, const Board& /* target */)
+{
+    m_attacks[player]++;
+    int who = m_player[player];
+    if (who < 0)
+        return;
+    m_counts.add(m_owner.base(who) + ATTACKS);
+    if (!validShot)
+        m_counts.add(m_owner.base(who) + WASTED);
+    else if (shotHit)
+    {
+        m_counts.add(m_owner.base(who) + HITS);
+        m_counts.add(m_owner.hitAt(who, p));
+    }
+}
+
+void SimulationStats::Shard::onSink(int player, const Player& /* attacker */, int shipId,
+                                    const Board& /* target */)
+{
+    int who = m_player[player];
+    if (who >= 0)
+        m_counts.add(m_owner.sinkTurnAt(who, shipId, m_attacks[player]));
+}
+
+void SimulationStats::Shard::onWin(int player, const Player& /* winner */,
+                                   const Player& /* loser */, const Board& /* winnerBoard */,
+                                   const Board& /* loserBoard */)
+{
+    int who = m_player[player];
+    if (who < 0)
+        return;
+    m_counts.add(m_owner.base(who) + WINS);
+    m_counts.add(m_owner.winLengthAt(who, m_attacks[0] + m_attacks[1]));
+}
+
+//******************** Reporting ************************************
+
+double distributionMean(const vector<uint64_t>& counts)
+{
+    double total = 0;
+    uint64_t n = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        total += double(i) * counts[i];
+        n += counts[i];
+    }
+    return n == 0 ? 0 : total / n;
+}
+
+int distributionPercentile(const vector<uint64_t>& counts, double pct)
+{
+    uint64_t n = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+        n += counts[i];
+    if (n == 0)
+        return 0;
+    uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(pct / 100 * n));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+            return (int)i;
+    }
+    return (int)counts.size() - 1;
+}
+
+// a row of bars for a distribution, in ten buckets spanning the turns
+// that actually occurred
+static void printBars(const vector<uint64_t>& counts, ostream& out)
+{
+    int lo = 0;
+    int hi = (int)counts.size() - 1;
+    while (lo < hi  &&  counts[lo] == 0)
+        lo++;
+    while (hi > lo  &&  counts[hi] == 0)
+        hi--;
+    const int NBUCKETS = 10;
+    int width = max(1, (hi - lo + NBUCKETS) / NBUCKETS);
+    vector<uint64_t> buckets(NBUCKETS, 0);
+    uint64_t most = 0;
+    for (int t = lo; t <= hi; t++)
+    {
+        uint64_t& b = buckets[min((t - lo) / width, NBUCKETS - 1)];
+        b += counts[t];
+        most = max(most, b);
+    }
+    for (int k = 0; k < NBUCKETS  &&  lo + k*width <= hi; k++)
+    {
+        out << "    " << setw(4) << lo + k*width << "-" << left << setw(4)
+            << min(hi, lo + (k+1)*width - 1) << right << " "
+            << string(most == 0 ? 0 : (buckets[k] * 40 + most - 1) / most, '#')
+            << " " << buckets[k] << endl;
+    }
+}
+
+void printSimulationSummary(const SimulationSummary& s, ostream& out)
+{
+    for (size_t p = 0; p < s.players.size(); p++)
+    {
+        const PlayerSimulationStats& ps = s.players[p];
+        out << ps.name << ": " << ps.games << " games, " << ps.wins << " wins";
+        out << fixed << setprecision(1);
+        if (ps.games > 0)
+            out << " (" << 100.0 * ps.wins / ps.games << "%)";
+        if (ps.attacks > 0)
+            out << ", hit rate " << 100.0 * ps.hits / ps.attacks << "%";
+        out << ", " << ps.wasted << " wasted shots" << endl;
+        if (ps.wins > 0)
+        {
+            out << "  turns to win: mean " << distributionMean(ps.winLength)
+                << ", p10 " << distributionPercentile(ps.winLength, 10)
+                << ", median " << distributionPercentile(ps.winLength, 50)
+                << ", p90 " << distributionPercentile(ps.winLength, 90) << endl;
+            printBars(ps.winLength, out);
+        }
+        for (size_t ship = 0; ship < s.shipNames.size(); ship++)
+        {
+            const vector<uint64_t>& d = ps.sinkTurn[ship];
+            uint64_t sunk = 0;
+            for (size_t t = 0; t < d.size(); t++)
+                sunk += d[t];
+            if (sunk == 0)
+                continue;
+            out << "  sank the " << s.shipNames[ship] << " " << sunk
+                << " times, on attack: mean " << distributionMean(d)
+                << ", median " << distributionPercentile(d, 50)
+                << ", p90 " << distributionPercentile(d, 90) << endl;
+        }
+        out.unsetf(ios::fixed);
+    }
+}
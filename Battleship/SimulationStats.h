@@ -0,0 +1,138 @@
+#ifndef SIMULATIONSTATS_INCLUDED
+#define SIMULATIONSTATS_INCLUDED
+
+#include "GameEvents.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <iosfwd>
+#include <cstdint>
+#include <cstddef>
+
+class Game;
+
+// Counters that only one thread adds to but any thread may read at any
+// time.  With a single writer an add is a plain load and store, with no
+// locked instruction; the counters are packed into cache lines of their
+// own, so two blocks never share a line.
+class CounterBlock
+{
+  public:
+    CounterBlock(size_t n);
+    void add(size_t i, uint64_t n = 1)
+    {
+        std::atomic<uint64_t>& c = m_lines[i / PER_LINE].n[i % PER_LINE];
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    uint64_t get(size_t i) const
+    {
+        return m_lines[i / PER_LINE].n[i % PER_LINE].load(std::memory_order_relaxed);
+    }
+    size_t size() const { return m_size; }
+
+  private:
+    static const size_t PER_LINE = 8;
+    struct alignas(64) Line
+    {
+        std::atomic<uint64_t> n[PER_LINE];
+    };
+    std::unique_ptr<Line[]> m_lines;
+    size_t m_size;
+};
+
+// Everything a SimulationStats has counted for one player.  "Turns" are
+// the attacks of both players together; a ship's sink turn is the number
+// of attacks its attacker had made when it went down.  Distributions are
+// indexed by turn, and the last entry also counts anything longer.
+struct PlayerSimulationStats
+{
+    std::string name;
+    uint64_t games;
+    uint64_t wins;
+    uint64_t attacks;
+    uint64_t hits;
+    uint64_t wasted;
+    std::vector<uint64_t> winLength;                // games won, by turns
+    std::vector<std::vector<uint64_t> > sinkTurn;   // per shipId: ships sunk,
+                                                    //   by sink turn
+    std::vector<uint64_t> hitsAt;                   // per cell, row-major
+};
+
+struct SimulationSummary
+{
+    int rows;
+    int cols;
+    std::vector<std::string> shipNames;
+    std::vector<PlayerSimulationStats> players;
+};
+
+// Win counts, game length and sink turn distributions and hit maps for
+// games played on many threads at once.  Each thread reports its games to
+// a shard of its own, so nothing is shared while the games run, and
+// summary() adds up the shards without stopping them; it can be called
+// for progress reports while games are still being played.
+//
+// Only players whose names were given to the constructor are counted,
+// and only games with the board size and fleet of the Game it was made
+// from.
+class SimulationStats
+{
+  public:
+    class alignas(64) Shard : public GameEventSink
+    {
+      public:
+        virtual void onPlacement(int player, const Player& p, const Board& b);
+        virtual void onAttack(int player, const Player& attacker, Point p, bool validShot,
+                              bool shotHit, bool shipDestroyed, int shipId,
+                              const Board& target);
+        virtual void onSink(int player, const Player& attacker, int shipId,
+                            const Board& target);
+        virtual void onWin(int player, const Player& winner, const Player& loser,
+                           const Board& winnerBoard, const Board& loserBoard);
+
+      private:
+        friend class SimulationStats;
+        Shard(const SimulationStats& owner);
+
+        const SimulationStats& m_owner;
+        CounterBlock m_counts;
+        int m_player[2];        // index of each side's player, or -1
+        int m_attacks[2];       // attacks each side has made this game
+    };
+
+      // nShards <= 0 means one per hardware thread
+    SimulationStats(const Game& g, const std::vector<std::string>& players, int nShards = 0);
+    int nShards() const { return (int)m_shards.size(); }
+      // the shard for thread i; no two threads may use one at once
+    Shard& shard(int i) { return *m_shards[i]; }
+    SimulationSummary summary() const;
+      // We prevent a SimulationStats object from being copied or assigned
+    SimulationStats(const SimulationStats&) = delete;
+    SimulationStats& operator=(const SimulationStats&) = delete;
+
+  private:
+      // where each of a player's counters is in a shard's CounterBlock
+    enum { GAMES, WINS, ATTACKS, HITS, WASTED, NSCALARS };
+    size_t base(int player) const { return player * m_perPlayer; }
+    size_t winLengthAt(int player, int turns) const;
+    size_t sinkTurnAt(int player, int shipId, int turn) const;
+    size_t hitAt(int player, Point p) const;
+    int playerIndex(const std::string& name) const;
+
+    int m_rows;
+    int m_cols;
+    std::vector<std::string> m_shipNames;
+    std::vector<std::string> m_players;
+    int m_maxTurns;
+    size_t m_perPlayer;
+    std::vector<std::unique_ptr<Shard> > m_shards;
+};
+
+  // The mean and nearest-rank percentile of a distribution
+double distributionMean(const std::vector<uint64_t>& counts);
+int distributionPercentile(const std::vector<uint64_t>& counts, double pct);
+
+void printSimulationSummary(const SimulationSummary& s, std::ostream& out);
+
+#endif // SIMULATIONSTATS_INCLUDED
@@ -0,0 +1,78 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(int nThreads)
+ : m_job(nullptr), m_nJobs(0), m_next(0), m_busy(0), m_run(0), m_stopping(false)
+{
+    if (nThreads <= 0)
+        nThreads = max(1, (int)thread::hardware_concurrency());
+    for (int i = 1; i < nThreads; i++)
+        m_workers.push_back(thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (size_t i = 0; i < m_workers.size(); i++)
+        m_workers[i].join();
+}
+
+void ThreadPool::run(int nJobs, const function<void(int)>& job)
+{
+    if (m_workers.empty())
+    {
+        for (int i = 0; i < nJobs; i++)
+            job(i);
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_job = &job;
+        m_nJobs = nJobs;
+        m_next = 0;
+        m_busy = (int)m_workers.size();
+        m_run++;
+    }
+    m_wake.notify_all();
+    takeJobs();
+
+    unique_lock<mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_job = nullptr;
+}
+
+void ThreadPool::work()
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, seen] { return m_stopping  ||  m_run != seen; });
+            if (m_stopping)
+                return;
+            seen = m_run;
+        }
+        takeJobs();
+        {
+            lock_guard<mutex> lock(m_mutex);
+            if (--m_busy == 0)
+                m_done.notify_one();
+        }
+    }
+}
+
+// jobs are taken one at a time from a shared counter, so a thread that
+// gets quick ones simply takes more of them
+void ThreadPool::takeJobs()
+{
+    for (int i = m_next++; i < m_nJobs; i = m_next++)
+        (*m_job)(i);
+}
@@ -0,0 +1,51 @@
+#ifndef THREADPOOL_INCLUDED
+#define THREADPOOL_INCLUDED
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// A fixed set of threads that stay alive between calls to run, so work
+// that is handed out many times a second (a player's every move, say)
+// doesn't pay to start and join threads each time.  The thread calling
+// run works on the jobs too, so a pool of one thread has no workers and
+// simply runs the jobs in turn.
+class ThreadPool
+{
+  public:
+      // nThreads counts the caller; 0 or less means one per hardware thread
+    explicit ThreadPool(int nThreads);
+    ~ThreadPool();
+
+    int nThreads() const { return (int)m_workers.size() + 1; }
+
+      // call job(i) for every i from 0 to nJobs-1, each exactly once, on
+      // whichever threads get to it first, and return when all are done.
+      // Only one thread may call run at a time.
+    void run(int nJobs, const std::function<void(int)>& job);
+
+      // We prevent a ThreadPool object from being copied or assigned
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+  private:
+    void work();
+    void takeJobs();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;     // a run has started, or we're stopping
+    std::condition_variable m_done;     // the last worker has finished a run
+    const std::function<void(int)>* m_job;
+    int m_nJobs;
+    std::atomic<int> m_next;            // the next job to hand out
+    int m_busy;                         // workers not yet done with this run
+    uint64_t m_run;                     // how many runs have started
+    bool m_stopping;
+};
+
+#endif // THREADPOOL_INCLUDED
@@ -0,0 +1,313 @@
+#include "Tournament.h"
+#include "Game.h"
+#include "Player.h"
+#include "GameRecord.h"
+#include "GameEvents.h"
+#include "SimulationStats.h"
+#include "Arena.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+// A batch of consecutive games of one pairing
+struct TournamentTask
+{
+    int pairing;
+    int firstGame;
+    int nGames;
+};
+
+// Each worker owns one of these.  The owner takes tasks from the back; an
+// idle worker steals from the front of someone else's queue, so a worker
+// stuck with long games doesn't hold up the rest.
+class TaskQueue
+{
+  public:
+    void push(const TournamentTask& t)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_tasks.push_back(t);
+    }
+
+    bool pop(TournamentTask& t)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_tasks.empty())
+            return false;
+        t = m_tasks.back();
+        m_tasks.pop_back();
+        return true;
+    }
+
+    bool steal(TournamentTask& t)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_tasks.empty())
+            return false;
+        t = m_tasks.front();
+        m_tasks.pop_front();
+        return true;
+    }
+
+  private:
+    mutex m_mutex;
+    deque<TournamentTask> m_tasks;
+};
+
+// Outcome of a single game: the winner's shot count, positive if the
+// pairing's first type won, negative if the second did, 0 if not played
+typedef vector<int> Outcomes;
+
+// The game and pair of players one worker plays a pairing with.  They are
+// made when the worker first gets a task of the pairing and kept until it
+// runs out of tasks, so a player that learns about its opponent, as an
+// adaptive player does, keeps what it learned from one task to the next.
+// They live in an arena of their own, which is never reset under them.
+struct PairingTable
+{
+    PairingTable() : game(nullptr), p1(nullptr), p2(nullptr) {}
+    ~PairingTable()
+    {
+        delete p1;
+        delete p2;
+        delete game;
+    }
+
+    GameArena arena;
+    Game* game;
+    Player* p1;         // of the pairing's first type
+    Player* p2;         // of its second type
+};
+
+static PairingTable* makeTable(const TournamentConfig& config,
+                               const pair<string, string>& pairing)
+{
+    PairingTable* t = new PairingTable;
+    GameArenaScope scope(&t->arena);
+    t->game = new Game(config.rows, config.cols);
+    if (config.addShips != nullptr  &&  !config.addShips(*t->game))
+        return t;
+    t->p1 = createPlayer(pairing.first, pairing.first, *t->game);
+    t->p2 = createPlayer(pairing.second, pairing.second, *t->game);
+    return t;
+}
+
+static void playTask(int self, PairingTable& table, const TournamentConfig& config,
+                     const TournamentTask& task, vector<Outcomes>& outcomes)
+{
+    Player* p1 = table.p1;
+    Player* p2 = table.p2;
+    if (p1 == nullptr  ||  p2 == nullptr)
+        return;
+    GameRecord record;
+    RecordingSink recording(record);
+    SinkList sinks;
+    if (config.recorder != nullptr)
+        sinks.add(&recording);
+    if (config.stats != nullptr)
+        sinks.add(&config.stats->shard(self));
+
+      // the players are only rematched, with their state for one game
+      // reset, so nothing is allocated game by game
+    GameArenaScope scope(&table.arena);
+    Game& g = *table.game;
+    for (int k = task.firstGame; k < task.firstGame + task.nGames; k++)
+    {
+          // alternate which type moves first
+        Player* first = (k % 2 == 0 ? p1 : p2);
+        Player* second = (k % 2 == 0 ? p2 : p1);
+        uint64_t seed = tournamentGameSeed(config.seed, task.pairing, k);
+        GameResult result;
+        Player* winner = (sinks.empty() ? g.rematch(first, second, seed, result)
+                                        : g.rematch(first, second, seed, result, sinks));
+        if (winner != nullptr)
+        {
+            if (config.recorder != nullptr)
+                config.recorder->write(record);
+            int shots = result.shots[result.winner - 1];
+            outcomes[task.pairing][k] = (winner == p1 ? shots : -shots);
+        }
+    }
+}
+
+static void worker(int self, vector<TaskQueue>& queues,
+                   const TournamentConfig& config,
+                   const vector<pair<string, string> >& pairings,
+                   vector<Outcomes>& outcomes)
+{
+    int n = (int)queues.size();
+    TournamentTask task;
+    vector<PairingTable*> tables(pairings.size(), nullptr);
+    while (true)
+    {
+        bool found = queues[self].pop(task);
+        for (int i = 1; !found  &&  i < n; i++)
+            found = queues[(self + i) % n].steal(task);
+          // tasks never create more tasks, so once every queue is empty
+          // there is nothing left to do
+        if (!found)
+            break;
+        PairingTable*& table = tables[task.pairing];
+        if (table == nullptr)
+            table = makeTable(config, pairings[task.pairing]);
+        playTask(self, *table, config, task, outcomes);
+    }
+    for (size_t i = 0; i < tables.size(); i++)
+        delete tables[i];
+}
+
+uint64_t tournamentGameSeed(uint64_t seed, int pairing, int game)
+{
+    Rng mix(seed ^ (uint64_t(pairing) << 32 | uint32_t(game)));
+    return mix.next();
+}
+
+// nearest-rank percentile of sorted values
+static int percentile(const vector<int>& sorted, double pct)
+{
+    if (sorted.empty())
+        return 0;
+    int rank = (int)ceil(pct / 100 * sorted.size());
+    return sorted[max(rank, 1) - 1];
+}
+
+static double mean(const vector<int>& v)
+{
+    if (v.empty())
+        return 0;
+    double total = 0;
+    for (size_t i = 0; i < v.size(); i++)
+        total += v[i];
+    return total / v.size();
+}
+
+static PairingStats summarize(const string& type1, const string& type2,
+                              const Outcomes& outcomes)
+{
+    vector<int> shots1;
+    vector<int> shots2;
+    for (size_t k = 0; k < outcomes.size(); k++)
+    {
+        if (outcomes[k] > 0)
+            shots1.push_back(outcomes[k]);
+        else if (outcomes[k] < 0)
+            shots2.push_back(-outcomes[k]);
+    }
+    sort(shots1.begin(), shots1.end());
+    sort(shots2.begin(), shots2.end());
+
+    PairingStats s;
+    s.type1 = type1;
+    s.type2 = type2;
+    s.wins1 = (int)shots1.size();
+    s.wins2 = (int)shots2.size();
+    s.games = s.wins1 + s.wins2;
+    s.winRate1 = s.winRate1Low = s.winRate1High = 0;
+    if (s.games > 0)
+    {
+        const double z = 1.96;
+        double n = s.games;
+        double p = s.wins1 / n;
+        double denom = 1 + z*z/n;
+        double center = (p + z*z/(2*n)) / denom;
+        double half = z * sqrt(p*(1-p)/n + z*z/(4*n*n)) / denom;
+        s.winRate1 = p;
+        s.winRate1Low = max(0.0, center - half);
+        s.winRate1High = min(1.0, center + half);
+    }
+    s.meanShotsToWin1 = mean(shots1);
+    s.meanShotsToWin2 = mean(shots2);
+    s.medianShotsToWin1 = percentile(shots1, 50);
+    s.medianShotsToWin2 = percentile(shots2, 50);
+    s.p90ShotsToWin1 = percentile(shots1, 90);
+    s.p90ShotsToWin2 = percentile(shots2, 90);
+    return s;
+}
+
+vector<PairingStats> runTournament(const TournamentConfig& config)
+{
+      // find the computer player types by asking createPlayer for each one
+    vector<string> types;
+    {
+        Game g(config.rows, config.cols);
+        for (int i = 0; i < nPlayerTypes(); i++)
+        {
+            Player* p = createPlayer(playerType(i), playerType(i), g);
+            if (p != nullptr  &&  !p->isHuman())
+                types.push_back(playerType(i));
+            delete p;
+        }
+    }
+
+    vector<pair<string, string> > pairings;
+    for (size_t i = 0; i < types.size(); i++)
+        for (size_t j = i+1; j < types.size(); j++)
+            pairings.push_back(make_pair(types[i], types[j]));
+
+    int nThreads = config.nThreads;
+    if (nThreads <= 0)
+        nThreads = max(1, (int)thread::hardware_concurrency());
+    if (config.stats != nullptr)
+        nThreads = min(nThreads, config.stats->nShards());
+    int gamesPerTask = max(1, config.gamesPerTask);
+
+      // deal the tasks round-robin; stealing evens out the load later
+    vector<TaskQueue> queues(nThreads);
+    vector<Outcomes> outcomes(pairings.size(),
+                              Outcomes(config.gamesPerPairing, 0));
+    int next = 0;
+    for (int p = 0; p < (int)pairings.size(); p++)
+    {
+        for (int k = 0; k < config.gamesPerPairing; k += gamesPerTask)
+        {
+            TournamentTask t;
+            t.pairing = p;
+            t.firstGame = k;
+            t.nGames = min(gamesPerTask, config.gamesPerPairing - k);
+            queues[next].push(t);
+            next = (next + 1) % nThreads;
+        }
+    }
+
+    vector<thread> threads;
+    for (int i = 1; i < nThreads; i++)
+        threads.push_back(thread(worker, i, ref(queues), cref(config),
+                                 cref(pairings), ref(outcomes)));
+    worker(0, queues, config, pairings, outcomes);
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    vector<PairingStats> stats;
+    for (size_t p = 0; p < pairings.size(); p++)
+        stats.push_back(summarize(pairings[p].first, pairings[p].second,
+                                  outcomes[p]));
+    return stats;
+}
+
+void printTournament(const vector<PairingStats>& stats, ostream& out)
+{
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        const PairingStats& s = stats[i];
+        out << s.type1 << " vs " << s.type2 << ": " << s.games << " games"
+            << endl;
+        out << fixed << setprecision(1)
+            << "  " << s.type1 << " won " << s.wins1 << " ("
+            << 100 * s.winRate1 << "%, 95% CI " << 100 * s.winRate1Low
+            << "-" << 100 * s.winRate1High << "%)" << endl;
+        out << "  shots to win: " << s.type1 << " mean "
+            << s.meanShotsToWin1 << ", median " << s.medianShotsToWin1
+            << ", p90 " << s.p90ShotsToWin1 << "; " << s.type2 << " mean "
+            << s.meanShotsToWin2 << ", median " << s.medianShotsToWin2
+            << ", p90 " << s.p90ShotsToWin2 << endl;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef TOURNAMENT_INCLUDED
+#define TOURNAMENT_INCLUDED
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+#include "globals.h"
+
+class Game;
+class GameRecordWriter;
+class SimulationStats;
+
+struct TournamentConfig
+{
+    TournamentConfig()
+     : rows(10), cols(10), addShips(nullptr), gamesPerPairing(1000),
+       gamesPerTask(64), nThreads(0), seed(threadRng().next()),
+       recorder(nullptr), stats(nullptr)
+    {}
+
+    int rows;
+    int cols;
+    bool (*addShips)(Game& g);  // sets up the fleet for every game
+    int gamesPerPairing;
+    int gamesPerTask;           // games a worker takes (or steals) at once
+    int nThreads;               // 0 means one per hardware thread
+    uint64_t seed;              // every game's seed is derived from this
+    GameRecordWriter* recorder; // if not null, every game is written here
+    SimulationStats* stats;     // if not null, every game is counted here;
+                                //   each worker thread uses its own shard,
+                                //   so there are no more threads than shards
+};
+
+// Results for one pairing of computer player types.  Players alternate
+// going first, and "shots to win" counts the attacks made by the winner.
+struct PairingStats
+{
+    std::string type1;
+    std::string type2;
+    int games;
+    int wins1;
+    int wins2;
+    double winRate1;
+    double winRate1Low;         // 95% Wilson confidence interval
+    double winRate1High;        //   for type1's win rate
+    double meanShotsToWin1;
+    double meanShotsToWin2;
+    int medianShotsToWin1;
+    int medianShotsToWin2;
+    int p90ShotsToWin1;
+    int p90ShotsToWin2;
+};
+
+// Play gamesPerPairing games for every pairing of the non-human types
+// createPlayer knows about, spread over a pool of worker threads.  A
+// worker plays all its games of a pairing with the same two players,
+// reset between games, so a player that adapts to its opponent carries
+// what it has learned through all of them.
+std::vector<PairingStats> runTournament(const TournamentConfig& config);
+
+// The seed of a game in a tournament, for replaying it on its own.  It
+// depends only on the tournament seed and the game's position, not on
+// which thread happened to play it, though a player that learns from
+// earlier games may not play it the same way on its own.
+uint64_t tournamentGameSeed(uint64_t seed, int pairing, int game);
+
+void printTournament(const std::vector<PairingStats>& stats, std::ostream& out);
+
+#endif // TOURNAMENT_INCLUDED
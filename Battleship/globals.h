@@ -2,9 +2,12 @@
 #define GLOBALS_INCLUDED
 
 #include <random>
+#include <cstdint>
+#include <cstddef>
 
-const int MAXROWS = 10;
-const int MAXCOLS = 10;
+// Boards may be any size, as long as cell numbers (row*cols+col) fit in
+// an int with room to spare
+const int MAXCELLS = 1 << 28;
 
 enum Direction {
     HORIZONTAL, VERTICAL
@@ -19,15 +22,123 @@ class Point
     int c;
 };
 
+// The outcome of one attack.  hit is false unless the attack was valid,
+// destroyed is false unless it hit, and shipId is -1 unless it destroyed
+// a ship, in which case it is that ship's.
+struct ShotResult
+{
+    bool valid;
+    bool hit;
+    bool destroyed;
+    int shipId;
+};
+
+// A view of count consecutive objects owned by someone else, for passing
+// an array and its length as one argument (a cut-down std::span)
+template <typename T>
+class Span
+{
+  public:
+    Span() : m_data(nullptr), m_size(0) {}
+    Span(T* data, size_t size) : m_data(data), m_size(size) {}
+    template <typename Container>
+    Span(Container& c) : m_data(c.data()), m_size(c.size()) {}
+    T* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    T& operator[](size_t i) const { return m_data[i]; }
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+
+  private:
+    T* m_data;
+    size_t m_size;
+};
+
+// A small, fast random number generator (xoshiro256**).  It is not shared:
+// every Game owns one, and every thread has one for randInt, so games can
+// run concurrently and any game can be replayed from its seed.
+class Rng
+{
+  public:
+    explicit Rng(uint64_t seed = 0) { this->seed(seed); }
+
+      // fill the state from the seed with splitmix64, as the xoshiro
+      // authors recommend
+    void seed(uint64_t seed)
+    {
+        for (int i = 0; i < 4; i++)
+            m_s[i] = splitmix(seed);
+    }
+
+    uint64_t next()
+    {
+        uint64_t result = rotl(m_s[1] * 5, 7) * 9;
+        uint64_t t = m_s[1] << 17;
+        m_s[2] ^= m_s[0];
+        m_s[3] ^= m_s[1];
+        m_s[1] ^= m_s[2];
+        m_s[0] ^= m_s[3];
+        m_s[2] ^= t;
+        m_s[3] = rotl(m_s[3], 45);
+        return result;
+    }
+
+      // Return a uniformly distributed random int from 0 to limit-1, using
+      // Lemire's multiply-and-reject method (no division in the common case
+      // and no modulo bias)
+    int randInt(int limit)
+    {
+        if (limit <= 1)
+            return 0;
+        uint32_t bound = (uint32_t)limit;
+        uint64_t m = uint64_t(uint32_t(next() >> 32)) * bound;
+        if (uint32_t(m) < bound)
+        {
+            uint32_t threshold = -bound % bound;
+            while (uint32_t(m) < threshold)
+                m = uint64_t(uint32_t(next() >> 32)) * bound;
+        }
+        return int(m >> 32);
+    }
+
+      // a uniformly distributed double in [0, 1)
+    double uniform()
+    {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+  private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    static uint64_t splitmix(uint64_t& x)
+    {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t m_s[4];
+};
+
+  // The calling thread's generator, seeded nondeterministically unless
+  // seedRandom has been called
+inline Rng& threadRng()
+{
+    thread_local std::random_device rd;
+    thread_local Rng rng(uint64_t(rd()) << 32 | rd());
+    return rng;
+}
+
+inline void seedRandom(uint64_t seed)
+{
+    threadRng().seed(seed);
+}
+
   // Return a uniformly distributed random int from 0 to limit-1
 inline int randInt(int limit)
 {
-    static std::random_device rd;
-    static std::mt19937 generator(rd());
-    if (limit < 1)
-        limit = 1;
-    std::uniform_int_distribution<> distro(0, limit-1);
-    return distro(generator);
+    return threadRng().randInt(limit);
 }
 
 #endif // GLOBALS_INCLUDED
@@ -1,7 +1,17 @@
 #include "Game.h"
 #include "Player.h"
+#include "Tournament.h"
+#include "GameRecord.h"
+#include "Replay.h"
+#include "Instrumentation.h"
+#include "SimulationStats.h"
+#include "Arena.h"
+#include "globals.h"
 #include <iostream>
 #include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
@@ -14,9 +24,61 @@ bool addStandardShips(Game& g)
            g.addShip(2, 'P', "patrol boat");
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     const int NTRIALS = 100;
+    string recordPath;
+    string replayPath;
+    string evaluateType;
+    string statsPath;
+    bool ansi = false;
+
+      // "--seed N" makes every game of this run reproducible, and
+      // "--record FILE" appends every tournament game to a record file.
+      // "--replay FILE" analyzes a record file instead of playing, and
+      // with "--evaluate TYPE" also replays its fleets against that type.
+      // "--stats FILE" writes per-player-type timings and counters at the
+      // end (as JSON if FILE ends in .json, else in Prometheus text format);
+      // they are only collected if built with -DBATTLESHIP_INSTRUMENT.
+      // "--ansi" shows the mini-game on a screen redrawn in place.
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--seed") == 0  &&  i+1 < argc)
+        {
+            uint64_t seed = strtoull(argv[++i], nullptr, 10);
+            seedRandom(seed);
+            cout << "Using random seed " << seed << endl;
+        }
+        else if (strcmp(argv[i], "--record") == 0  &&  i+1 < argc)
+            recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0  &&  i+1 < argc)
+            replayPath = argv[++i];
+        else if (strcmp(argv[i], "--evaluate") == 0  &&  i+1 < argc)
+            evaluateType = argv[++i];
+        else if (strcmp(argv[i], "--stats") == 0  &&  i+1 < argc)
+            statsPath = argv[++i];
+        else if (strcmp(argv[i], "--ansi") == 0)
+            ansi = true;
+    }
+
+    if (!replayPath.empty())
+    {
+        RecordFile file(replayPath);
+        GameRecord first;
+        if (!file.isOpen()  ||  !file.firstRecord(first))
+        {
+            cout << "No game records in " << replayPath << endl;
+            return 1;
+        }
+        if (file.damaged())
+            cout << replayPath << " ends in a damaged chunk; it is ignored" << endl;
+          // analyze the games of the size the file starts with
+        printReplayStats(analyzeRecords(file, first.rows, first.cols), cout);
+        if (!evaluateType.empty())
+            printReplayEvaluation(evaluateOnRecords(file, evaluateType,
+                                                    first.rows, first.cols), cout);
+        return 0;
+    }
 
     cout << "Select one of these choices for an example of the game:" << endl;
     cout << "  1.  A mini-game between two mediocre players" << endl;
@@ -24,6 +86,7 @@ int main()
     cout << "  3.  A " << NTRIALS
          << "-game match between a mediocre and an awful player, with no pauses"
          << endl;
+    cout << "  4.  A tournament among all the computer player types" << endl;
     cout << "Enter your choice: ";
     string line;
     getline(cin,line);
@@ -34,6 +97,7 @@ int main()
     else if (line[0] == '1')
     {
         Game g(2, 3);
+        g.setAnsiDisplay(ansi);
         g.addShip(2, 'R', "rowboat");
         Player* p1 = createPlayer("mediocre", "Popeye", g);
         Player* p2 = createPlayer("mediocre", "Bluto", g);
@@ -54,32 +118,70 @@ int main()
     }
     else if (line[0] == '3')
     {
-        int nMediocreWins = 0;
+          // one game and one pair of players, rematched for every trial
+          // with only their state reset; each trial gets the seed a newly
+          // made Game would have had
+        GameArena arena;
+        GameArenaScope scope(&arena);
+        Game g(10, 10);
+        addStandardShips(g);
+        vector<string> names;
+        names.push_back("Good Andrew");
+        names.push_back("Mediocre Mimi");
+        SimulationStats stats(g, names, 1);
+        Player* p1 = createPlayer("good", names[0], g);
+        Player* p2 = createPlayer("mediocre", names[1], g);
 
         for (int k = 1; k <= NTRIALS; k++)
         {
             cout << "============================= Game " << k
                  << " =============================" << endl;
-            Game g(10, 10);
-            addStandardShips(g);
-            Player* p1 = createPlayer("good", "Good Andrew", g);
-            Player* p2 = createPlayer("mediocre", "Mediocre Mimi", g);
-            Player* winner = (k % 2 == 1 ?
-                                g.play(p1, p2, false) : g.play(p2, p1, false));
-            if (winner == p2)
-                nMediocreWins++;
-            delete p1;
-            delete p2;
-
+            GameResult result;
+            uint64_t seed = threadRng().next();
+            Player* winner = (k % 2 == 1 ? g.rematch(p1, p2, seed, result, stats.shard(0))
+                                         : g.rematch(p2, p1, seed, result, stats.shard(0)));
+            if (winner != nullptr)
+                cout << winner->name() << " wins after " << result.turns
+                     << " turns." << endl;
         }
-        cout << "The mediocre player won " << nMediocreWins << " out of "
+        delete p1;
+        delete p2;
+        SimulationSummary summary = stats.summary();
+        cout << "The mediocre player won " << summary.players[1].wins << " out of "
              << NTRIALS << " games." << endl;
+        printSimulationSummary(summary, cout);
           // We'd expect a mediocre player to win most of the games against
           // an awful player.  Similarly, a good player should outperform
           // a mediocre player.
     }
+    else if (line[0] == '4')
+    {
+        TournamentConfig config;
+        config.addShips = addStandardShips;
+        config.gamesPerPairing = 10 * NTRIALS;
+        GameRecordWriter* recorder = nullptr;
+        if (!recordPath.empty())
+        {
+            recorder = new GameRecordWriter(recordPath);
+            if (!recorder->isOpen())
+            {
+                cout << "Cannot write game records to " << recordPath << endl;
+                delete recorder;
+                return 1;
+            }
+            config.recorder = recorder;
+        }
+        printTournament(runTournament(config), cout);
+        delete recorder;
+    }
     else
     {
        cout << "That's not one of the choices." << endl;
     }
+
+    if (!statsPath.empty()  &&  !dumpInstrumentation(statsPath))
+    {
+        cout << "Cannot write statistics to " << statsPath << endl;
+        return 1;
+    }
 }
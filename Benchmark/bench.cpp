@@ -0,0 +1,599 @@
+// Microbenchmarks for the game's hot paths, reported the way Google
+// Benchmark reports them (console table or JSON), so results can be
+// compared from run to run to catch regressions.  Build it from the
+// repository root with every Battleship source but main.cpp:
+//
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread -IBattleship -o bench
+//       Benchmark/bench.cpp $(ls Battleship/*.cpp | grep -v main.cpp)
+//
+// Options:
+//   --benchmark_filter=REGEX     run only benchmarks whose names match
+//   --benchmark_min_time=SECS    time each benchmark at least this long (0.5)
+//   --benchmark_format=console|json
+//   --benchmark_out=FILE         also write the JSON report to FILE
+//   --seed=N                     seed for every generator (default 1)
+
+#include "Game.h"
+#include "Board.h"
+#include "Player.h"
+#include "FleetSampler.h"
+#include "PlacementSolver.h"
+#include "Arena.h"
+#include "BatchEngine.h"
+#include "BatchPolicy.h"
+#include "globals.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <regex>
+#include <chrono>
+#include <thread>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+// The timing loop of one benchmark run.  Code between pauseTiming() and
+// resumeTiming() (setting up the next round, say) isn't counted.
+class BenchState
+{
+  public:
+    BenchState(long iterations)
+     : m_iterations(iterations), m_left(iterations), m_items(0),
+       m_running(false), m_real(0), m_cpu(0)
+    {}
+
+    bool keepRunning()
+    {
+        if (!m_running  &&  m_left == m_iterations)
+            start();
+        if (m_left-- > 0)
+            return true;
+        stop();
+        return false;
+    }
+
+    void pauseTiming() { stop(); }
+    void resumeTiming() { start(); }
+
+      // report items_per_second as well (games played, say)
+    void setItemsProcessed(long n) { m_items = n; }
+
+    long iterations() const { return m_iterations; }
+    long items() const { return m_items; }
+    double realSeconds() const { return m_real; }
+    double cpuSeconds() const { return m_cpu; }
+
+  private:
+    void start()
+    {
+        m_running = true;
+        m_realStart = chrono::steady_clock::now();
+        m_cpuStart = clock();
+    }
+
+    void stop()
+    {
+        if (!m_running)
+            return;
+        m_running = false;
+        m_real += chrono::duration<double>(chrono::steady_clock::now() - m_realStart).count();
+        m_cpu += double(clock() - m_cpuStart) / CLOCKS_PER_SEC;
+    }
+
+    long m_iterations;
+    long m_left;
+    long m_items;
+    bool m_running;
+    double m_real;
+    double m_cpu;
+    chrono::steady_clock::time_point m_realStart;
+    clock_t m_cpuStart;
+};
+
+struct Benchmark
+{
+    string name;
+    function<void(BenchState&)> run;
+};
+
+struct BenchResult
+{
+    string name;
+    long iterations;
+    double realNs;          // per iteration
+    double cpuNs;
+    double itemsPerSecond;  // 0 if the benchmark doesn't count items
+};
+
+static uint64_t benchSeed = 1;
+
+bool addStandardShips(Game& g)
+{
+    return g.addShip(5, 'A', "aircraft carrier")  &&
+           g.addShip(4, 'B', "battleship")  &&
+           g.addShip(3, 'D', "destroyer")  &&
+           g.addShip(3, 'S', "submarine")  &&
+           g.addShip(2, 'P', "patrol boat");
+}
+
+static string sizeName(int n)
+{
+    ostringstream s;
+    s << n << "x" << n;
+    return s.str();
+}
+
+//******************** Benchmarks *************************************
+
+static void benchPlaceUnplace(BenchState& state, int n)
+{
+    Game g(n, n);
+    g.seed(benchSeed);
+    addStandardShips(g);
+    Board b(g);
+
+      // cycle through every spot the carrier can go
+    GameVector<Placement> spots = FleetSampler(g).solver().placements(g.shipLength(0));
+    size_t i = 0;
+    while (state.keepRunning())
+    {
+        const Placement& p = spots[i];
+        b.placeShip(p.topOrLeft, 0, p.dir);
+        b.unplaceShip(p.topOrLeft, 0, p.dir);
+        if (++i == spots.size())
+            i = 0;
+    }
+}
+
+// attack every cell of a freshly laid out board in random order, then
+// lay out the board again (untimed) and start over
+static void benchAttack(BenchState& state, int n)
+{
+    Game g(n, n);
+    g.seed(benchSeed);
+    addStandardShips(g);
+    Board b(g);
+    FleetSampler sampler(g);
+    sampler.placeFleet(b, g.rng());
+
+    vector<Point> order;
+    for (int r = 0; r < n; r++)
+        for (int c = 0; c < n; c++)
+            order.push_back(Point(r, c));
+    for (size_t k = order.size() - 1; k > 0; k--)
+        swap(order[k], order[g.rng().randInt(int(k) + 1)]);
+
+    size_t i = 0;
+    while (state.keepRunning())
+    {
+        b.attack(order[i]);
+        if (++i == order.size())
+        {
+            state.pauseTiming();
+            b.clear();
+            sampler.placeFleet(b, g.rng());
+            i = 0;
+            state.resumeTiming();
+        }
+    }
+}
+
+// attack every cell of a freshly laid out board in random order with one
+// call, then lay out the board again (untimed) and start over; an
+// iteration is the whole board
+static void benchAttackBatch(BenchState& state, int n)
+{
+    Game g(n, n);
+    g.seed(benchSeed);
+    addStandardShips(g);
+    Board b(g);
+    FleetSampler sampler(g);
+    sampler.placeFleet(b, g.rng());
+
+    vector<Point> order;
+    for (int r = 0; r < n; r++)
+        for (int c = 0; c < n; c++)
+            order.push_back(Point(r, c));
+    for (size_t k = order.size() - 1; k > 0; k--)
+        swap(order[k], order[g.rng().randInt(int(k) + 1)]);
+    vector<ShotResult> results(order.size());
+
+    while (state.keepRunning())
+    {
+        b.attackBatch(order, results);
+        state.pauseTiming();
+        b.clear();
+        sampler.placeFleet(b, g.rng());
+        state.resumeTiming();
+    }
+}
+
+static void benchAllShipsDestroyed(BenchState& state, int n)
+{
+    Game g(n, n);
+    g.seed(benchSeed);
+    addStandardShips(g);
+    Board b(g);
+    FleetSampler(g).placeFleet(b, g.rng());
+    long destroyed = 0;
+    while (state.keepRunning())
+        destroyed += b.allShipsDestroyed();
+    if (destroyed != 0)
+        cerr << "unexpected result" << endl;
+}
+
+static void benchSolve(BenchState& state, int n)
+{
+    Game g(n, n);
+    g.seed(benchSeed);
+    addStandardShips(g);
+    PlacementSolver solver(g);
+    vector<Bitboard> blocks;
+    for (int k = 0; k < 64; k++)
+        blocks.push_back(solver.randomBlock(g.rng()));
+    GameVector<Placement> fleet;
+    size_t i = 0;
+    while (state.keepRunning())
+    {
+        solver.solve(blocks[i], fleet);
+        i = (i + 1) % blocks.size();
+    }
+}
+
+static void benchPlaceShips(BenchState& state, const string& type, int n)
+{
+    Game g(n, n);
+    g.seed(benchSeed);
+    addStandardShips(g);
+    Board b(g);
+    Player* p = createPlayer(type, type, g);
+    while (state.keepRunning())
+    {
+        b.clear();
+        p->placeShips(b);
+    }
+    delete p;
+}
+
+// one move: recommendAttack and recording its result, since a player's
+// next recommendation depends on the last one's outcome; a new game is
+// set up (untimed) whenever the fleet is sunk
+static void benchRecommendAttack(BenchState& state, const string& type, int n)
+{
+    Game g(n, n);
+    g.seed(benchSeed);
+    addStandardShips(g);
+    Board b(g);
+    FleetSampler sampler(g);
+    sampler.placeFleet(b, g.rng());
+    Player* p = createPlayer(type, type, g);
+    while (state.keepRunning())
+    {
+        Point attack = p->recommendAttack();
+        ShotResult shot = b.attack(attack);
+        p->recordAttackResult(attack, shot.valid, shot.hit, shot.destroyed, shot.shipId);
+        if (b.allShipsDestroyed())
+        {
+            state.pauseTiming();
+            delete p;
+            b.clear();
+            sampler.placeFleet(b, g.rng());
+            p = createPlayer(type, type, g);
+            state.resumeTiming();
+        }
+    }
+    delete p;
+}
+
+static void benchRandInt(BenchState& state)
+{
+    seedRandom(benchSeed);
+    long total = 0;
+    while (state.keepRunning())
+        total += randInt(100);
+    if (total < 0)
+        cerr << "unexpected result" << endl;
+}
+
+// complete games between two players of one type, optionally with each
+// game's memory coming from an arena that is reset between games
+static void benchGame(BenchState& state, const string& type, int n, bool useArena)
+{
+    uint64_t seed = benchSeed;
+    long games = 0;
+    GameArena arena;
+    while (state.keepRunning())
+    {
+        arena.reset();
+        GameArenaScope scope(useArena ? &arena : nullptr);
+        Game g(n, n);
+        g.seed(seed++);
+        addStandardShips(g);
+        Player* p1 = createPlayer(type, "p1", g);
+        Player* p2 = createPlayer(type, "p2", g);
+        GameResult result;
+        if (g.play(p1, p2, result) != nullptr)
+            games++;
+        delete p1;
+        delete p2;
+    }
+    state.setItemsProcessed(games);
+}
+
+// the same games, but with one Game and pair of players rematched
+static void benchRematch(BenchState& state, const string& type, int n)
+{
+    uint64_t seed = benchSeed;
+    long games = 0;
+    Game g(n, n);
+    addStandardShips(g);
+    Player* p1 = createPlayer(type, "p1", g);
+    Player* p2 = createPlayer(type, "p2", g);
+    while (state.keepRunning())
+    {
+        GameResult result;
+        if (g.rematch(p1, p2, seed++, result) != nullptr)
+            games++;
+    }
+    delete p1;
+    delete p2;
+    state.setItemsProcessed(games);
+}
+
+// the same kind of games, a batch of BATCH_GAMES at a time on a
+// BatchEngine; items are games, so the rate compares with BM_Rematch's
+static const int BATCH_GAMES = 256;
+
+static void benchBatch(BenchState& state, const string& type, int n)
+{
+    uint64_t seed = benchSeed;
+    long games = 0;
+    Game g(n, n);
+    addStandardShips(g);
+    BatchPolicy* p1 = createBatchPolicy(type, g);
+    BatchPolicy* p2 = createBatchPolicy(type, g);
+    BatchEngine e(g, BATCH_GAMES);
+    BatchResult result;
+    while (state.keepRunning())
+    {
+        e.play(*p1, *p2, seed++, result);
+        games += result.wins[0] + result.wins[1];
+    }
+    delete p1;
+    delete p2;
+    state.setItemsProcessed(games);
+}
+
+static vector<Benchmark> allBenchmarks()
+{
+    vector<string> types;
+    {
+        Game g(10, 10);
+        for (int i = 0; i < nPlayerTypes(); i++)
+        {
+            Player* p = createPlayer(playerType(i), playerType(i), g);
+            if (p != nullptr  &&  !p->isHuman())
+                types.push_back(playerType(i));
+            delete p;
+        }
+    }
+    const int sizes[] = { 10, 25 };
+
+    vector<Benchmark> all;
+    for (int n : sizes)
+    {
+        all.push_back({ "BM_PlaceUnplace/" + sizeName(n),
+                        [n](BenchState& s) { benchPlaceUnplace(s, n); } });
+        all.push_back({ "BM_Attack/" + sizeName(n),
+                        [n](BenchState& s) { benchAttack(s, n); } });
+        all.push_back({ "BM_AttackBatch/" + sizeName(n),
+                        [n](BenchState& s) { benchAttackBatch(s, n); } });
+        all.push_back({ "BM_AllShipsDestroyed/" + sizeName(n),
+                        [n](BenchState& s) { benchAllShipsDestroyed(s, n); } });
+        all.push_back({ "BM_Solve/" + sizeName(n),
+                        [n](BenchState& s) { benchSolve(s, n); } });
+    }
+    for (const string& t : types)
+        for (int n : sizes)
+            all.push_back({ "BM_PlaceShips/" + t + "/" + sizeName(n),
+                            [t, n](BenchState& s) { benchPlaceShips(s, t, n); } });
+    for (const string& t : types)
+        for (int n : sizes)
+            all.push_back({ "BM_RecommendAttack/" + t + "/" + sizeName(n),
+                            [t, n](BenchState& s) { benchRecommendAttack(s, t, n); } });
+    all.push_back({ "BM_RandInt", benchRandInt });
+    for (const string& t : types)
+        for (int n : sizes)
+            all.push_back({ "BM_Game/" + t + "/" + sizeName(n),
+                            [t, n](BenchState& s) { benchGame(s, t, n, false); } });
+    for (const string& t : types)
+        for (int n : sizes)
+            all.push_back({ "BM_GameInArena/" + t + "/" + sizeName(n),
+                            [t, n](BenchState& s) { benchGame(s, t, n, true); } });
+    for (const string& t : types)
+        for (int n : sizes)
+            all.push_back({ "BM_Rematch/" + t + "/" + sizeName(n),
+                            [t, n](BenchState& s) { benchRematch(s, t, n); } });
+    for (int i = 0; i < nBatchPolicyTypes(); i++)
+    {
+        string t = batchPolicyType(i);
+        for (int n : sizes)
+            all.push_back({ "BM_Batch/" + t + "/" + sizeName(n),
+                            [t, n](BenchState& s) { benchBatch(s, t, n); } });
+    }
+    return all;
+}
+
+//******************** Running and reporting **************************
+
+// run with more and more iterations until a run takes at least minTime,
+// as Google Benchmark does
+static BenchResult runBenchmark(const Benchmark& bm, double minTime)
+{
+    long iterations = 1;
+    while (true)
+    {
+        BenchState state(iterations);
+        bm.run(state);
+        double t = state.realSeconds();
+        if (t >= minTime  ||  iterations >= 1000000000L)
+        {
+            BenchResult r;
+            r.name = bm.name;
+            r.iterations = iterations;
+            r.realNs = 1e9 * t / iterations;
+            r.cpuNs = 1e9 * state.cpuSeconds() / iterations;
+            r.itemsPerSecond = (state.items() > 0  &&  t > 0 ? state.items() / t : 0);
+            return r;
+        }
+          // aim a bit past minTime, but grow by at most 10 times per run
+        double factor = (t > 0 ? 1.4 * minTime / t : 10);
+        iterations = max(iterations + 1, long(iterations * min(factor, 10.0)));
+    }
+}
+
+static string jsonEscape(const string& s)
+{
+    string out;
+    for (char ch : s)
+    {
+        if (ch == '"'  ||  ch == '\\')
+            out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+static void writeJson(const vector<BenchResult>& results, ostream& out)
+{
+    time_t now = time(nullptr);
+    char date[64];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    out << "{\n";
+    out << "  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\",\n";
+#else
+    out << "    \"library_build_type\": \"debug\",\n";
+#endif
+    out << "    \"seed\": " << benchSeed << "\n";
+    out << "  },\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& r = results[i];
+        out << "    {\n";
+        out << "      \"name\": \"" << jsonEscape(r.name) << "\",\n";
+        out << "      \"run_name\": \"" << jsonEscape(r.name) << "\",\n";
+        out << "      \"run_type\": \"iteration\",\n";
+        out << "      \"iterations\": " << r.iterations << ",\n";
+        out << "      \"real_time\": " << setprecision(10) << r.realNs << ",\n";
+        out << "      \"cpu_time\": " << setprecision(10) << r.cpuNs << ",\n";
+        if (r.itemsPerSecond > 0)
+            out << "      \"items_per_second\": " << setprecision(10) << r.itemsPerSecond << ",\n";
+        out << "      \"time_unit\": \"ns\"\n";
+        out << "    }" << (i+1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void printConsoleHeader(ostream& out)
+{
+    out << left << setw(40) << "Benchmark" << right << setw(15) << "Time"
+        << setw(15) << "CPU" << setw(14) << "Iterations" << endl;
+    out << string(84, '-') << endl;
+}
+
+static void printConsoleLine(const BenchResult& r, ostream& out)
+{
+    out << left << setw(40) << r.name << right << fixed << setprecision(1)
+        << setw(12) << r.realNs << " ns" << setw(12) << r.cpuNs << " ns"
+        << setw(14) << r.iterations;
+    if (r.itemsPerSecond > 0)
+        out << " items_per_second=" << setprecision(2) << r.itemsPerSecond << "/s";
+    out << endl;
+}
+
+static bool flagValue(const char* arg, const char* flag, string& value)
+{
+    size_t n = strlen(flag);
+    if (strncmp(arg, flag, n) != 0  ||  arg[n] != '=')
+        return false;
+    value = arg + n + 1;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    string filter = ".";
+    double minTime = 0.5;
+    string format = "console";
+    string outPath;
+    for (int i = 1; i < argc; i++)
+    {
+        string v;
+        if (flagValue(argv[i], "--benchmark_filter", v))
+            filter = v;
+        else if (flagValue(argv[i], "--benchmark_min_time", v))
+            minTime = atof(v.c_str());
+        else if (flagValue(argv[i], "--benchmark_format", v))
+            format = v;
+        else if (flagValue(argv[i], "--benchmark_out", v))
+            outPath = v;
+        else if (flagValue(argv[i], "--seed", v))
+            benchSeed = strtoull(v.c_str(), nullptr, 10);
+        else
+        {
+            cerr << "Unknown option " << argv[i] << endl;
+            return 1;
+        }
+    }
+    seedRandom(benchSeed);
+
+    regex re;
+    try
+    {
+        re = regex(filter);
+    }
+    catch (const regex_error&)
+    {
+        cerr << "Bad benchmark filter " << filter << endl;
+        return 1;
+    }
+
+    bool console = (format != "json");
+    if (console)
+        printConsoleHeader(cout);
+    vector<BenchResult> results;
+    for (const Benchmark& bm : allBenchmarks())
+    {
+        if (!regex_search(bm.name, re))
+            continue;
+        results.push_back(runBenchmark(bm, minTime));
+        if (console)
+            printConsoleLine(results.back(), cout);
+    }
+
+    if (!console)
+        writeJson(results, cout);
+    if (!outPath.empty())
+    {
+        ofstream out(outPath);
+        if (!out)
+        {
+            cerr << "Cannot write " << outPath << endl;
+            return 1;
+        }
+        writeJson(results, out);
+    }
+}